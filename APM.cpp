@@ -5,9 +5,14 @@ APM::APM(const int n, const int s) : AdaptiveMap(n * s, 1023), N(n * s), steps(s
   printf("Created APM with n = %d, s = %d\n", n, s);
 #endif
   assert(s > 4); // number of steps - must be a positive integer bigger than 4
+  // the rows of all contexts are the same: compute the first one and copy it
   for( int i = 0; i < N; ++i ) {
-    int p = ((i % steps * 2 + 1) * 4096) / (steps * 2) - 2048;
-    t[i] = (uint32_t(squash(p)) << 20U) + 6; //initial count: 6
+    if( i < steps ) {
+      int p = ((i * 2 + 1) * 4096) / (steps * 2) - 2048;
+      t[i] = (uint32_t(squash(p)) << 20U) + 6; //initial count: 6
+    } else {
+      t[i] = t[i - steps];
+    }
   }
 }
 
@@ -16,6 +21,13 @@ void APM::update() {
   AdaptiveMap::update(&t[cxt]);
 }
 
+void APM::prefetch(const int cx) const {
+  const uint32_t *row = &t[cx * steps];
+  PREFETCH(row);
+  PREFETCH(row + steps / 2);
+  PREFETCH(row + steps - 1);
+}
+
 auto APM::p(int pr, int cx, const int lim) -> int {
   updater->subscribe(this);
   assert(pr >= 0 && pr < 4096);
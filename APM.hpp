@@ -41,6 +41,13 @@ public:
      * @return the adjusted probability
      */
     int p(int pr, int cx, int lim);
+
+    /**
+     * Start loading the cache lines of context @ref cx, so that the following p() with the same context does not
+     * stall (the misses of several APMs are then waited for at once).
+     * @param cx the context
+     */
+    void prefetch(int cx) const;
 };
 
 #endif //PAQ8PX_APM_HPP
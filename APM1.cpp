@@ -17,6 +17,13 @@ APM1::APM1(const int n, const int r) : index(0), n(n), t(n * 33), rate(r) {
   }
 }
 
+void APM1::prefetch(const int cxt) const {
+  const uint16_t *row = &t[cxt * 33];
+  PREFETCH(row);
+  PREFETCH(row + 16);
+  PREFETCH(row + 32);
+}
+
 auto APM1::p(int pr, const int cxt) -> int {
   shared->updateBroadcaster->subscribe(this);
   assert(pr >= 0 && pr < 4096 && cxt >= 0 && cxt < n);
@@ -37,6 +37,12 @@ public:
      * @return adjusted probability
      */
     int p(int pr, int cxt);
+
+    /**
+     * Start loading the cache lines of context @ref cxt, see APM::prefetch().
+     * @param cxt the context
+     */
+    void prefetch(int cxt) const;
     void update() override;
 };
 
@@ -68,6 +68,11 @@ public:
      */
     [[nodiscard]] uint64_t size() const { return usedSize; }
 
+    /**
+     * @return the number of T elements the array can hold without reallocation.
+     */
+    [[nodiscard]] uint64_t capacity() const { return reservedSize; }
+
     /**
      * Grows or shrinks the array.
      * @param newSize the new size of the array
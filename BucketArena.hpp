@@ -0,0 +1,49 @@
+#ifndef PAQ8PX_BUCKETARENA_HPP
+#define PAQ8PX_BUCKETARENA_HPP
+
+#include "Array.hpp"
+#include "Bucket.hpp"
+#include "Hash.hpp"
+#include "Shared.hpp"
+#include <cstdint>
+
+/**
+ * A single hash table of @ref Bucket "Buckets" shared by the large @ref ContextMap2 instances (compression switch "m").
+ * Each model's maps normally own a table sized for the model, so memory of models that are idle for the current
+ * block type (e.g. the image models during text) is held but unused. When sharing, the total memory is fixed and
+ * the models that are actually working use it. Each map adds its own salt to its contexts.
+ */
+class BucketArena {
+private:
+    static constexpr int memMultiplier = 32; /**< arena size is shared->mem * memMultiplier: the same as the NormalModel's table */
+    Array<Bucket, 64> table;
+    uint32_t mapCount = 0;
+
+    explicit BucketArena(const uint64_t size) : table(size / sizeof(Bucket)) {}
+
+public:
+    static auto getInstance() -> BucketArena & {
+      static BucketArena instance {Shared::getInstance()->mem * memMultiplier};
+      return instance;
+    }
+
+    /**
+     * Determine if a context map should hash into the arena instead of using a table of its own.
+     * Only the maps that scale with the compression level are shared, the small ones stay in their own cache friendly tables.
+     * @param size the table size the map was constructed with
+     * @return true if the map should use the arena
+     */
+    static auto isUsedFor(const uint64_t size) -> bool {
+      const Shared *const shared = Shared::getInstance();
+      return shared->contextMapArena && size >= shared->mem;
+    }
+
+    auto buckets() -> Array<Bucket, 64> & { return table; }
+
+    /**
+     * @return a new salt for the contexts of the next map that hashes into the arena
+     */
+    auto nextSalt() -> uint64_t { return ++mapCount * PHI64; }
+};
+
+#endif //PAQ8PX_BUCKETARENA_HPP
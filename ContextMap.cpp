@@ -1,7 +1,7 @@
 #include "ContextMap.hpp"
 
 ContextMap::ContextMap(uint64_t m, const int contexts) : C(contexts), t(m >> 6U), cp(contexts), cp0(contexts), cxt(contexts), chk(contexts), runP(contexts),
-        sm(contexts, 256, 1023, StateMap::BitHistory), cn(0), mask(uint32_t(t.size() - 1)), hashBits(ilog2(mask + 1)), validFlags(0) {
+        sm(contexts, 256, 1023, StateMap::BitHistory), cn(0), lookedUp(0), mask(uint32_t(t.size() - 1)), hashBits(ilog2(mask + 1)), validFlags(0) {
 #ifdef VERBOSE
   printf("Created ContextMap with m = %" PRIu64 ", contexts = %d\n", m, contexts);
 #endif
@@ -13,9 +13,17 @@ ContextMap::ContextMap(uint64_t m, const int contexts) : C(contexts), t(m >> 6U)
 void ContextMap::set(const uint64_t cx) {
   assert(cn >= 0 && cn < C);
   const uint32_t ctx = cxt[cn] = finalize64(cx, hashBits);
-  const uint16_t checksum = chk[cn] = static_cast<uint16_t>(checksum64(cx, hashBits, 16));
-  uint8_t *base = cp0[cn] = cp[cn] = t[ctx].find(checksum, shared->chosenSimd);
-  runP[cn] = base + 3;
+  chk[cn] = static_cast<uint16_t>(checksum64(cx, hashBits, 16));
+  PREFETCH(&t[ctx]); // the bucket is searched in mix(), when all contexts are set
+  cn++;
+  validFlags = (validFlags << 1U) + 1;
+}
+
+void ContextMap::lookUp(const int i) {
+  const uint32_t ctx = cxt[i];
+  const uint16_t checksum = chk[i];
+  uint8_t *base = cp0[i] = cp[i] = t[ctx].find(checksum, shared->chosenSimd);
+  runP[i] = base + 3;
   // update pending bit histories for bits 2-7
   if( base[3] == 2 ) {
     const int c = base[4] + 256;
@@ -28,8 +36,6 @@ void ContextMap::set(const uint64_t cx) {
     p[1 + ((c >> 2U) & 1U)] = 1 + ((c >> 1U) & 1U);
     p[3 + ((c >> 1U) & 3U)] = 1 + (c & 1U);
   }
-  cn++;
-  validFlags = (validFlags << 1U) + 1;
 }
 
 void ContextMap::skip() {
@@ -40,6 +46,14 @@ void ContextMap::skip() {
 
 void ContextMap::update() {
   INJECT_SHARED_y
+  if( shared->bitPosition == 2 || shared->bitPosition == 5 ) {
+    // start loading all the new buckets, then search them in the original order
+    for( int i = 0; i < cn; ++i ) {
+      if(((validFlags >> (cn - 1 - i)) & 1U) != 0 ) {
+        PREFETCH(&t[(cxt[i] + shared->c0) & mask]);
+      }
+    }
+  }
   for( int i = 0; i < cn; ++i ) {
     if(((validFlags >> (cn - 1 - i)) & 1) != 0 ) {
       // update bit history state byte
@@ -91,11 +105,18 @@ void ContextMap::update() {
   }
   if( shared->bitPosition == 0 ) {
     cn = 0;
+    lookedUp = 0;
     validFlags = 0;
   }
 }
 
 void ContextMap::mix(Mixer &m) {
+  // search the buckets of the contexts set since the last call, in the order they were set
+  for( ; lookedUp < cn; lookedUp++ ) {
+    if(((validFlags >> (cn - 1 - lookedUp)) & 1U) != 0 ) {
+      lookUp(lookedUp);
+    }
+  }
   shared->updateBroadcaster->subscribe(this);
   sm.subscribe();
   for( int i = 0; i < cn; ++i ) {
@@ -94,11 +94,19 @@ private:
     Array<uint8_t *> runP; /**< c [0..3] = count, value, unused, unused */
     StateMap sm; /**< c maps of state -> p */
     int cn; /**< next context to set by set() */
+    int lookedUp; /**< number of contexts whose buckets were already searched by lookUp() */
     const uint32_t mask;
     const int hashBits;
     uint64_t validFlags;
     Ilog *ilog = Ilog::getInstance();
 
+    /**
+     * Search the bucket of context @ref i and run its pending bit history updates.
+     * set() only prefetches the bucket, so the cache misses of all the contexts of a byte overlap.
+     * @param i the index of the context
+     */
+    void lookUp(int i);
+
 public:
     /**
      * Construct using @ref m bytes of memory for @ref contexts contexts
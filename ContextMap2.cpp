@@ -1,12 +1,15 @@
 #include "ContextMap2.hpp"
 
-ContextMap2::ContextMap2(const uint64_t size, const uint32_t contexts, const int scale, const uint32_t uw) : C(contexts), table(size / sizeof(Bucket)),
+ContextMap2::ContextMap2(const uint64_t size, const uint32_t contexts, const int scale, const uint32_t uw) : C(contexts),
+        ownTable(BucketArena::isUsedFor(size) ? 0 : size / sizeof(Bucket)),
+        table(ownTable.size() != 0 ? ownTable : BucketArena::getInstance().buckets()),
         bitState(contexts), bitState0(contexts), byteHistory(contexts), contexts(contexts), checksums(contexts),
         runMap(contexts, (1U << 12U), 127, StateMap::Run),         /* StateMap : s, n, lim, init */ // 63-255
         stateMap(contexts, (1U << 8U), 511, StateMap::BitHistory), /* StateMap : s, n, lim, init */ // 511-1023
         bhMap8B(contexts, (1U << 8U), 511, StateMap::Generic),     /* StateMap : s, n, lim, init */ // 511-1023
         bhMap12B(contexts, (1U << 12U), 511, StateMap::Generic),   /* StateMap : s, n, lim, init */ // 255-1023
-        index(0), mask(uint32_t(table.size() - 1)), hashBits(ilog2(mask + 1)), validFlags(0), scale(scale), useWhat(uw) {
+        index(0), lookedUp(0), mask(uint32_t(table.size() - 1)), hashBits(ilog2(mask + 1)),
+        salt(ownTable.size() != 0 ? 0 : BucketArena::getInstance().nextSalt()), validFlags(0), scale(scale), useWhat(uw) {
 #ifdef VERBOSE
   printf("Created ContextMap2 with size = %" PRIu64 ", contexts = %d, scale = %d, uw = %d\n", size, contexts, scale, uw);
 #endif
@@ -19,12 +22,21 @@ ContextMap2::ContextMap2(const uint64_t size, const uint32_t contexts, const int
   }
 }
 
-void ContextMap2::set(const uint64_t ctx) {
+void ContextMap2::set(uint64_t ctx) {
   assert(index >= 0 && index < C);
+  ctx += salt;
   const uint32_t ctx0 = contexts[index] = finalize64(ctx, hashBits);
-  const uint16_t chk0 = checksums[index] = static_cast<uint16_t>(checksum64(ctx, hashBits, 16));
-  uint8_t *base = bitState[index] = bitState0[index] = table[ctx0].find(chk0, shared->chosenSimd);
-  byteHistory[index] = &base[3];
+  checksums[index] = static_cast<uint16_t>(checksum64(ctx, hashBits, 16));
+  PREFETCH(&table[ctx0]); // the bucket is searched in mix(), when all contexts are set
+  index++;
+  validFlags = (validFlags << 1U) + 1;
+}
+
+void ContextMap2::lookUp(const uint32_t i) {
+  const uint32_t ctx0 = contexts[i];
+  const uint16_t chk0 = checksums[i];
+  uint8_t *base = bitState[i] = bitState0[i] = table[ctx0].find(chk0, shared->chosenSimd);
+  byteHistory[i] = &base[3];
   const uint8_t runCount = base[3];
   if( runCount == 255 ) { // pending
     // update pending bit histories for bits 2-7
@@ -45,8 +57,6 @@ void ContextMap2::set(const uint64_t ctx) {
       base[3] = 255; // runCount: flag for skipping updating bits 2..7
     }
   }
-  index++;
-  validFlags = (validFlags << 1U) + 1;
 }
 
 void ContextMap2::skip() {
@@ -57,6 +67,14 @@ void ContextMap2::skip() {
 
 void ContextMap2::update() {
   INJECT_SHARED_y
+  if( shared->bitPosition == 2 || shared->bitPosition == 5 ) {
+    // start loading all the new buckets, then search them in the original order
+    for( uint32_t i = 0; i < index; i++ ) {
+      if(((validFlags >> (index - 1 - i)) & 1U) != 0 ) {
+        PREFETCH(&table[(contexts[i] + shared->c0) & mask]);
+      }
+    }
+  }
   for( uint32_t i = 0; i < index; i++ ) {
     if(((validFlags >> (index - 1 - i)) & 1U) != 0 ) {
       if( bitState[i] != nullptr ) {
@@ -115,6 +133,7 @@ void ContextMap2::update() {
   }
   if( shared->bitPosition == 0 ) {
     index = 0;
+    lookedUp = 0;
     validFlags = 0;
   } // start over
 }
@@ -122,6 +141,12 @@ void ContextMap2::update() {
 void ContextMap2::setScale(const int Scale) { scale = Scale; }
 
 void ContextMap2::mix(Mixer &m) {
+  // search the buckets of the contexts set since the last call, in the order they were set
+  for( ; lookedUp < index; lookedUp++ ) {
+    if(((validFlags >> (index - 1 - lookedUp)) & 1U) != 0 ) {
+      lookUp(lookedUp);
+    }
+  }
   shared->updateBroadcaster->subscribe(this);
   stateMap.subscribe();
   if((useWhat & CM_USE_RUN_STATS) != 0U ) {
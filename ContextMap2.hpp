@@ -21,6 +21,7 @@ mapped to predictions.
 
 #include "IPredictor.hpp"
 #include "Bucket.hpp"
+#include "BucketArena.hpp"
 #include "Hash.hpp"
 #include "Ilog.hpp"
 #include "Mixer.hpp"
@@ -43,7 +44,8 @@ private:
     Shared *shared = Shared::getInstance();
     Random rnd;
     const uint32_t C; /**< max number of contexts */
-    Array<Bucket, 64> table; /**< bit histories for bits 0-1, 2-4, 5-7. For 0-1, also contains run stats in bitState[][3] and byte history in bitState[][4..6] */
+    Array<Bucket, 64> ownTable; /**< the table of this map, empty when the map hashes into the @ref BucketArena */
+    Array<Bucket, 64> &table; /**< bit histories for bits 0-1, 2-4, 5-7. For 0-1, also contains run stats in bitState[][3] and byte history in bitState[][4..6] */
     Array<uint8_t *> bitState; /**< @ref C pointers to current bit history states */
     Array<uint8_t *> bitState0; /**< First element of 7 element array containing bitState[i] */
     Array<uint8_t *> byteHistory; /**< @ref C pointers to run stats plus byte history, 4 bytes, [RunStats,1..3] */
@@ -54,12 +56,21 @@ private:
     StateMap bhMap8B;
     StateMap bhMap12B;
     uint32_t index; /**< next context to set by @ref ContextMap2::set(), resets to zero after every round */
+    uint32_t lookedUp; /**< number of contexts whose buckets were already searched by @ref ContextMap2::lookUp() */
     const uint32_t mask;
     const int hashBits;
+    const uint64_t salt; /**< added to the contexts to keep apart the maps sharing the @ref BucketArena (0 for an own table) */
     uint64_t validFlags;
     int scale;
     uint32_t useWhat;
 
+    /**
+     * Search the bucket of context @ref i (or claim a slot for it) and run its pending bit history updates.
+     * set() only prefetches the bucket, so the cache misses of all the contexts of a byte overlap.
+     * @param i the index of the context
+     */
+    void lookUp(uint32_t i);
+
 public:
     int order = 0; // is set after mix()
     /**
@@ -25,13 +25,10 @@ auto Encoder::code(int i) -> int {
 }
 
 Encoder::Encoder(Mode m, File *f) : mode(m), archive(f), x1(0), x2(0xffffffff), x(0), alt(nullptr) {
-  if( mode == DECOMPRESS ) {
+  if( mode == DECOMPRESS && archive->isSeekable()) { // the length of a stream is unknown: no progress indicator
     uint64_t start = size();
     archive->setEnd();
     uint64_t end = size();
-    if( end >= (1ULL << 31U)) {
-      quit("Large archives not yet supported.");
-    }
     setStatusRange(0.0, static_cast<float>(end));
     archive->setpos(start);
   }
@@ -89,13 +86,27 @@ void Encoder::encodeBlockSize(uint64_t blockSize) {
   compress(uint8_t(blockSize));
 }
 
+void Encoder::encodeModelMask(const uint32_t mask) {
+  assert(mode == COMPRESS);
+  if( mask == modelMask ) {
+    return;
+  }
+  compress(MODELMASK);
+  encodeBlockSize(0);
+  compress((mask >> 24U) & 0xFFU);
+  compress((mask >> 16U) & 0xFFU);
+  compress((mask >> 8U) & 0xFFU);
+  compress(mask & 0xFFU);
+  modelMask = mask;
+}
+
 auto Encoder::decodeBlockSize() -> uint64_t {
   uint64_t blockSize = 0;
   uint8_t b = 0;
   int i = 0;
   do {
     b = decompress();
-    blockSize |= uint64_t((b & 0x7FU) << i);
+    blockSize |= uint64_t(b & 0x7FU) << i;
     i += 7;
   } while((b >> 7U) > 0 );
   return blockSize;
@@ -112,6 +123,9 @@ void Encoder::printStatus(uint64_t n, uint64_t size) const {
 }
 
 void Encoder::printStatus() const {
+  if( p2 == 0 ) {
+    return;
+  }
   fprintf(stderr, "%6.2f%%\b\b\b\b\b\b\b", float(size()) / (p2 + 1) * 100);
   fflush(stderr);
 }
@@ -24,6 +24,7 @@ private:
     uint32_t x; /**< Decompress mode: last 4 input bytes of archive */
     File *alt; /**< decompress() source in COMPRESS mode */
     float p1 {}, p2 {}; /**< percentages for progress indicator: 0.0 .. 1.0 */
+    uint32_t modelMask = MODEL_ALL; /**< the optional models the ContextModel runs, it starts with all of them too */
     Shared *shared = Shared::getInstance();
 
     /**
@@ -71,15 +72,20 @@ public:
      */
     auto decompress() -> int;
     /**
-     * @todo Large file support
+     * Encodes @ref blockSize as a VLI (7 bits per byte, least significant group first).
      * @param blockSize
      */
     void encodeBlockSize(uint64_t blockSize);
     /**
-     * @todo Large file support
+     * Decodes a VLI encoded by encodeBlockSize().
      * @return
      */
     auto decodeBlockSize() -> uint64_t;
+    /**
+     * Selects the optional models for the following blocks with a MODELMASK block, unless they are selected already.
+     * @param mask the MODEL_* bits of the models to run
+     */
+    void encodeModelMask(uint32_t mask);
     void setStatusRange(float perc1, float perc2);
     void printStatus(uint64_t n, uint64_t size) const;
     void printStatus() const;
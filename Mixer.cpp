@@ -13,15 +13,6 @@ Mixer::Mixer(const int n, const int m, const int s) : n(n), m(m), s(s), scaleFac
   reset();
 }
 
-void Mixer::add(const int x) {
-#ifdef VERBOSE
-  printf("Mixer::add(%d)\n", x);
-#endif
-  assert(nx < n);
-  assert(x == short(x));
-  tx[nx++] = static_cast<short>(x);
-}
-
 void Mixer::set(const uint32_t cx, const uint32_t range, const int rate) {
   assert(numContexts < s);
   assert(cx < range);
@@ -215,9 +215,17 @@ public:
      * prediction should be positive to predict a 1 bit, negative for 0,
      * nominally +-256 to +-2K.  The maximum allowed value is +-32K but
      * using such large values may cause overflow if n is large.
+     * Defined here so that it is inlined into the models even without link time optimization.
      * @param x
      */
-    void add(int x);
+    void add(const int x) {
+#ifdef VERBOSE
+      printf("Mixer::add(%d)\n", x);
+#endif
+      assert(nx < n);
+      assert(x == short(x));
+      tx[nx++] = static_cast<short>(x);
+    }
 
     /**
      *  Selects @ref cx as one of @ref range neural networks to
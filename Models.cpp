@@ -24,6 +24,22 @@
 
 Models::Models(ModelStats *st) : stats(st) {}
 
+void Models::releaseIdleModels() {
+  bytesModeled++;
+  if( shared->idleModelRelease == 0 || (bytesModeled & 0xFFFFU) != 0 ) { // check in every 64 KB only
+    return;
+  }
+  const uint64_t maxIdleBytes = (1ULL << 20U) << (shared->idleModelRelease - 1);
+  jpeg.releaseIfIdle(bytesModeled, maxIdleBytes);
+  image24Bit.releaseIfIdle(bytesModeled, maxIdleBytes);
+  image8Bit.releaseIfIdle(bytesModeled, maxIdleBytes);
+  image4Bit.releaseIfIdle(bytesModeled, maxIdleBytes);
+#ifndef DISABLE_AUDIOMODEL
+  audio8Bit.releaseIfIdle(bytesModeled, maxIdleBytes);
+  audio16Bit.releaseIfIdle(bytesModeled, maxIdleBytes);
+#endif //DISABLE_AUDIOMODEL
+}
+
 auto Models::normalModel() -> NormalModel & {
   static NormalModel instance {stats, shared->mem * 32};
   return instance;
@@ -106,23 +122,19 @@ auto Models::linearPredictionModel() -> LinearPredictionModel & {
 }
 
 auto Models::jpegModel() -> JpegModel & {
-  static JpegModel instance {shared->mem}; /**< Not the actual memory use - see in the model */
-  return instance;
+  return jpeg.get(bytesModeled, shared->mem); /**< Not the actual memory use - see in the model */
 }
 
 auto Models::image24BitModel() -> Image24BitModel & {
-  static Image24BitModel instance {stats, shared->mem * 4};
-  return instance;
+  return image24Bit.get(bytesModeled, stats, shared->mem * 4);
 }
 
 auto Models::image8BitModel() -> Image8BitModel & {
-  static Image8BitModel instance {stats, shared->mem * 4};
-  return instance;
+  return image8Bit.get(bytesModeled, stats, shared->mem * 4);
 }
 
 auto Models::image4BitModel() -> Image4BitModel & {
-  static Image4BitModel instance {shared->mem / 2};
-  return instance;
+  return image4Bit.get(bytesModeled, shared->mem / 2);
 }
 
 auto Models::image1BitModel() -> Image1BitModel & {
@@ -133,13 +145,11 @@ auto Models::image1BitModel() -> Image1BitModel & {
 #ifndef DISABLE_AUDIOMODEL
 
 auto Models::audio8BitModel() -> Audio8BitModel & {
-  static Audio8BitModel instance {stats};
-  return instance;
+  return audio8Bit.get(bytesModeled, stats);
 }
 
 auto Models::audio16BitModel() -> Audio16BitModel & {
-  static Audio16BitModel instance {stats};
-  return instance;
+  return audio16Bit.get(bytesModeled, stats);
 }
 
 #endif //DISABLE_AUDIOMODEL
\ No newline at end of file
@@ -24,16 +24,67 @@
 #include "model/WordModel.hpp"
 #include "model/XMLModel.hpp"
 
+/**
+ * A block type specific model that is created on first use and can be released when its block type has not been seen
+ * for a while (see Shared::idleModelRelease). A released model is created again, from scratch, when it is needed:
+ * the encoder and the decoder release it at the same byte, so they stay in sync.
+ * @tparam T the model class
+ */
+template<class T>
+class ReleasableModel {
+private:
+    T *model = nullptr;
+    uint64_t lastUse = 0; /**< value of Models::bytesModeled when the model was last used */
+
+public:
+    ReleasableModel() = default;
+    ReleasableModel(const ReleasableModel &) = delete;
+    auto operator=(const ReleasableModel &) -> ReleasableModel & = delete;
+    ~ReleasableModel() { delete model; }
+
+    template<typename... Args>
+    auto get(const uint64_t now, Args... args) -> T & {
+      lastUse = now;
+      if( model == nullptr ) {
+        model = new T(args...);
+      }
+      return *model;
+    }
+
+    void releaseIfIdle(const uint64_t now, const uint64_t maxIdleBytes) {
+      if( model != nullptr && now - lastUse > maxIdleBytes ) {
+        delete model;
+        model = nullptr;
+      }
+    }
+};
+
 /**
  * This is a factory class for lazy object creation for models.
  * Objects created within this class are instantiated on first use and guaranteed to be destroyed.
+ * The block type specific models can be released when idle, see @ref releaseIdleModels().
  */
 class Models {
 private:
     Shared *shared = Shared::getInstance();
     ModelStats *stats; //read-write
+    uint64_t bytesModeled = 0;
+    ReleasableModel<JpegModel> jpeg;
+    ReleasableModel<Image24BitModel> image24Bit;
+    ReleasableModel<Image8BitModel> image8Bit;
+    ReleasableModel<Image4BitModel> image4Bit;
+#ifndef DISABLE_AUDIOMODEL
+    ReleasableModel<Audio8BitModel> audio8Bit;
+    ReleasableModel<Audio16BitModel> audio16Bit;
+#endif //DISABLE_AUDIOMODEL
 public:
     explicit Models(ModelStats *st);
+
+    /**
+     * Called at every byte boundary: releases the block type specific models that were not used
+     * in the last 2^(Shared::idleModelRelease-1) MB (if enabled).
+     */
+    void releaseIdleModels();
     auto normalModel() -> NormalModel &;
     auto dmcForest() -> DmcForest &;
     auto charGroupModel() -> CharGroupModel &;
@@ -44,7 +44,7 @@ void Predictor::trainText(const char *const dictionary, int iterations) {
                     NormalModel::MIXERCONTEXTSETS + WordModel::MIXERCONTEXTSETS);
   stats.blockType = TEXT;
   assert(shared->buf.getpos() == 0 && stats.blPos == 0);
-  FileDisk f;
+  FileMapped f; // the dictionary is read several times: read it straight from a memory mapping
   printf("Pre-training models with text...");
   OpenFromMyFolder::anotherFile(&f, dictionary);
   int c = 0;
@@ -102,7 +102,7 @@ void Predictor::trainExe() {
   ExeModel &exeModel = models.exeModel();
   DummyMixer dummyM(ExeModel::MIXERINPUTS, ExeModel::MIXERCONTEXTS, ExeModel::MIXERCONTEXTSETS);
   assert(shared->buf.getpos() == 0 && stats.blPos == 0);
-  FileDisk f;
+  FileMapped f;
   printf("Pre-training x86/x64 model...");
   OpenFromMyFolder::myself(&f);
   int c = 0;
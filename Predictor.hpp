@@ -2,6 +2,7 @@
 #define PAQ8PX_PREDICTOR_HPP
 
 #include "file/FileDisk.hpp"
+#include "file/FileMapped.hpp"
 #include "DummyMixer.hpp"
 #include "ModelStats.hpp"
 #include "Models.hpp"
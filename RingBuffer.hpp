@@ -9,7 +9,12 @@ template<class T>
 class RingBuffer {
 private:
     Array<T> b;
-    uint32_t offset {0}; /**< Number of input bytes in buffer (not wrapped), will be masked when used for indexing */
+    /**
+     * Number of input bytes in buffer (not wrapped), will be masked when used for indexing.
+     * It wraps around after 4 GB of input. This is harmless: the size is a power of 2 (at most 2^31), so the masked index stays
+     * continuous, and the models use positions only in differences and in hashes.
+     */
+    uint32_t offset {0};
     uint32_t mask;
 
 public:
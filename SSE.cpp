@@ -11,24 +11,46 @@ auto SSE::p(int pr0) -> int {
   const uint8_t c0 = shared->c0;
   const uint8_t bitPosition = shared->bitPosition;
   const uint32_t c4 = shared->c4;
+  if((c4 & 0xffffffU) != hashedBytes ) { // a new byte (the first prediction of SSE is at bitPosition 1)
+    hashedBytes = c4 & 0xffffffU;
+    order2Hash = finalize64(hash(c4 & 0xffffU), 16);
+    order3Hash = finalize64(hash(c4 & 0xffffffU), 16);
+  }
   int pr = 0;
   int pr1 = 0;
   int pr2 = 0;
   int pr3 = 0;
+  // The contexts of a block type are computed and their table rows prefetched before the first interpolation, so that
+  // the cache misses of the stages overlap. The default stage only has APM1s (single cache line rows): there it does not pay.
   switch( stats->blockType ) {
     case TEXT:
     case TEXT_EOL: {
+      const uint32_t ctx0 = (c0 << 8U) | (stats->Text.mask & 0xFU) | ((stats->misses & 0xFU) << 4U);
+      const uint32_t ctx1 = finalize64(hash(bitPosition, stats->misses & 3U, c4 & 0xffffU, stats->Text.mask >> 4U), 16);
+      const uint32_t ctx2 = finalize64(hash(c0, stats->Match.expectedByte, stats->Match.length3), 16);
+      const uint32_t ctx3 = finalize64(hash(c0, c4 & 0xffffU, stats->Text.firstLetter), 16);
+      const uint32_t ctx4 = finalize64(hash(stats->Match.expectedByte, stats->Match.length3, c4 & 0xffU), 16);
+      const uint32_t ctx5 = finalize64(hash(c0, c4 & 0x00ffffffU), 16);
+      const uint32_t ctx6 = finalize64(hash(c0, c4 & 0xffffff00U), 16);
+      Text.APMs[0].prefetch(ctx0);
+      Text.APMs[1].prefetch(ctx1);
+      Text.APMs[2].prefetch(ctx2);
+      Text.APMs[3].prefetch(ctx3);
+      Text.APM1s[0].prefetch(ctx4);
+      Text.APM1s[1].prefetch(ctx5);
+      Text.APM1s[2].prefetch(ctx6);
+
       int limit = 0x3FFU >> (static_cast<int>(stats->blPos < 0xFFF) * 2);
-      pr = Text.APMs[0].p(pr0, (c0 << 8U) | (stats->Text.mask & 0xFU) | ((stats->misses & 0xFU) << 4U), limit);
-      pr1 = Text.APMs[1].p(pr0, finalize64(hash(bitPosition, stats->misses & 3U, c4 & 0xffffU, stats->Text.mask >> 4U), 16), limit);
-      pr2 = Text.APMs[2].p(pr0, finalize64(hash(c0, stats->Match.expectedByte, stats->Match.length3), 16), limit);
-      pr3 = Text.APMs[3].p(pr0, finalize64(hash(c0, c4 & 0xffffU, stats->Text.firstLetter), 16), limit);
+      pr = Text.APMs[0].p(pr0, ctx0, limit);
+      pr1 = Text.APMs[1].p(pr0, ctx1, limit);
+      pr2 = Text.APMs[2].p(pr0, ctx2, limit);
+      pr3 = Text.APMs[3].p(pr0, ctx3, limit);
 
       pr0 = (pr0 + pr1 + pr2 + pr3 + 2) >> 2U;
 
-      pr1 = Text.APM1s[0].p(pr0, finalize64(hash(stats->Match.expectedByte, stats->Match.length3, c4 & 0xffU), 16));
-      pr2 = Text.APM1s[1].p(pr, finalize64(hash(c0, c4 & 0x00ffffffU), 16));
-      pr3 = Text.APM1s[2].p(pr, finalize64(hash(c0, c4 & 0xffffff00U), 16));
+      pr1 = Text.APM1s[0].p(pr0, ctx4);
+      pr2 = Text.APM1s[1].p(pr, ctx5);
+      pr3 = Text.APM1s[2].p(pr, ctx6);
 
       pr = (pr + pr1 + pr2 + pr3 + 2) >> 2U;
       pr = (pr + pr0 + 1) >> 1U;
@@ -36,44 +58,72 @@ auto SSE::p(int pr0) -> int {
     }
     case IMAGE24:
     case IMAGE32: {
+      const uint32_t ctx0 = (c0 << 4U) | (stats->misses & 0xFU);
+      const uint32_t ctx1 = finalize64(hash(c0, stats->Image.pixels.W, stats->Image.pixels.WW), 16);
+      const uint32_t ctx2 = finalize64(hash(c0, stats->Image.pixels.N, stats->Image.pixels.NN), 16);
+      const uint32_t ctx3 = (c0 << 8U) | stats->Image.ctx;
+      const uint32_t ctx4 = finalize64(hash(c0, stats->Image.pixels.W, (c4 & 0xffU) - stats->Image.pixels.Wp1, stats->Image.plane), 16);
+      const uint32_t ctx5 = finalize64(hash(c0, stats->Image.pixels.N, (c4 & 0xffU) - stats->Image.pixels.Np1, stats->Image.plane), 16);
+      Image.Color.APMs[0].prefetch(ctx0);
+      Image.Color.APMs[1].prefetch(ctx1);
+      Image.Color.APMs[2].prefetch(ctx2);
+      Image.Color.APMs[3].prefetch(ctx3);
+      Image.Color.APM1s[0].prefetch(ctx4);
+      Image.Color.APM1s[1].prefetch(ctx5);
+
       int limit = 0x3FFU >> (static_cast<int>(stats->blPos < 0xFFFU) * 4);
-      pr = Image.Color.APMs[0].p(pr0, (c0 << 4U) | (stats->misses & 0xFU), limit);
-      pr1 = Image.Color.APMs[1].p(pr0, finalize64(hash(c0, stats->Image.pixels.W, stats->Image.pixels.WW), 16), limit);
-      pr2 = Image.Color.APMs[2].p(pr0, finalize64(hash(c0, stats->Image.pixels.N, stats->Image.pixels.NN), 16), limit);
-      pr3 = Image.Color.APMs[3].p(pr0, (c0 << 8U) | stats->Image.ctx, limit);
+      pr = Image.Color.APMs[0].p(pr0, ctx0, limit);
+      pr1 = Image.Color.APMs[1].p(pr0, ctx1, limit);
+      pr2 = Image.Color.APMs[2].p(pr0, ctx2, limit);
+      pr3 = Image.Color.APMs[3].p(pr0, ctx3, limit);
 
       pr0 = (pr0 + pr1 + pr2 + pr3 + 2) >> 2U;
-      pr1 = Image.Color.APM1s[0].p(pr,
-                                   finalize64(hash(c0, stats->Image.pixels.W, (c4 & 0xffU) - stats->Image.pixels.Wp1, stats->Image.plane),
-                                              16));
-      pr2 = Image.Color.APM1s[1].p(pr,
-                                   finalize64(hash(c0, stats->Image.pixels.N, (c4 & 0xffU) - stats->Image.pixels.Np1, stats->Image.plane),
-                                              16));
+      pr1 = Image.Color.APM1s[0].p(pr, ctx4);
+      pr2 = Image.Color.APM1s[1].p(pr, ctx5);
 
       pr = (pr * 2 + pr1 * 3 + pr2 * 3 + 4) >> 3U;
       pr = (pr + pr0 + 1) >> 1U;
       break;
     }
     case IMAGE8GRAY: {
+      const uint32_t ctx0 = (c0 << 4) | (stats->misses & 0xFU);
+      const uint32_t ctx1 = (c0 << 8) | stats->Image.ctx;
+      const uint32_t ctx2 = bitPosition | (stats->Image.ctx & 0xF8U) | (stats->Match.expectedByte << 8U);
+      Image.Gray.APMs[0].prefetch(ctx0);
+      Image.Gray.APMs[1].prefetch(ctx1);
+      Image.Gray.APMs[2].prefetch(ctx2);
+
       int limit = 0x3FFU >> (static_cast<int>(stats->blPos < 0xFFF) * 4);
-      pr = Image.Gray.APMs[0].p(pr0, (c0 << 4) | (stats->misses & 0xFU), limit);
-      pr1 = Image.Gray.APMs[1].p(pr, (c0 << 8) | stats->Image.ctx, limit);
-      pr2 = Image.Gray.APMs[2].p(pr0, bitPosition | (stats->Image.ctx & 0xF8U) | (stats->Match.expectedByte << 8U), limit);
+      pr = Image.Gray.APMs[0].p(pr0, ctx0, limit);
+      pr1 = Image.Gray.APMs[1].p(pr, ctx1, limit);
+      pr2 = Image.Gray.APMs[2].p(pr0, ctx2, limit);
 
       pr0 = (2 * pr0 + pr1 + pr2 + 2) >> 2U;
       pr = (pr + pr0 + 1) >> 1U;
       break;
     }
     case IMAGE8: {
+      const uint32_t ctx0 = (c0 << 4U) | (stats->misses & 0xFU);
+      const uint32_t ctx1 = finalize64(hash(c0 | stats->Image.pixels.W << 8U | stats->Image.pixels.N << 16U), 16);
+      const uint32_t ctx2 = finalize64(hash(c0 | stats->Image.pixels.N << 8U | stats->Image.pixels.NN << 16U), 16);
+      const uint32_t ctx3 = finalize64(hash(c0 | stats->Image.pixels.W << 8U | stats->Image.pixels.WW << 16U), 16);
+      const uint32_t ctx4 = finalize64(hash(c0 | stats->Match.expectedByte << 8U | stats->Image.pixels.N << 16U), 16);
+      Image.Palette.APMs[0].prefetch(ctx0);
+      Image.Palette.APMs[1].prefetch(ctx1);
+      Image.Palette.APMs[2].prefetch(ctx2);
+      Image.Palette.APMs[3].prefetch(ctx3);
+      Image.Palette.APM1s[0].prefetch(ctx4);
+      Image.Palette.APM1s[1].prefetch(ctx1);
+
       int limit = 0x3FFU >> (static_cast<int>(stats->blPos < 0xFFFU) * 4);
-      pr = Image.Palette.APMs[0].p(pr0, (c0 << 4U) | (stats->misses & 0xFU), limit);
-      pr1 = Image.Palette.APMs[1].p(pr0, finalize64(hash(c0 | stats->Image.pixels.W << 8U | stats->Image.pixels.N << 16U), 16), limit);
-      pr2 = Image.Palette.APMs[2].p(pr0, finalize64(hash(c0 | stats->Image.pixels.N << 8U | stats->Image.pixels.NN << 16U), 16), limit);
-      pr3 = Image.Palette.APMs[3].p(pr0, finalize64(hash(c0 | stats->Image.pixels.W << 8U | stats->Image.pixels.WW << 16U), 16), limit);
+      pr = Image.Palette.APMs[0].p(pr0, ctx0, limit);
+      pr1 = Image.Palette.APMs[1].p(pr0, ctx1, limit);
+      pr2 = Image.Palette.APMs[2].p(pr0, ctx2, limit);
+      pr3 = Image.Palette.APMs[3].p(pr0, ctx3, limit);
 
       pr0 = (pr0 + pr1 + pr2 + pr3 + 2) >> 2U;
-      pr1 = Image.Palette.APM1s[0].p(pr0, finalize64(hash(c0 | stats->Match.expectedByte << 8U | stats->Image.pixels.N << 16U), 16));
-      pr2 = Image.Palette.APM1s[1].p(pr, finalize64(hash(c0 | stats->Image.pixels.W << 8U | stats->Image.pixels.N << 16U), 16));
+      pr1 = Image.Palette.APM1s[0].p(pr0, ctx4);
+      pr2 = Image.Palette.APM1s[1].p(pr, ctx1);
 
       pr = (pr * 2 + pr1 + pr2 + 2) >> 2U;
       pr = (pr + pr0 + 1) >> 1U;
@@ -84,16 +134,18 @@ auto SSE::p(int pr0) -> int {
       break;
     }
     default: {
-      pr = Generic.APM1s[0].p(pr0, (stats->Match.length3) << 11U | c0 << 3U | (stats->misses & 0x7U));
+      const uint16_t ctx0 = (stats->Match.length3) << 11U | c0 << 3U | (stats->misses & 0x7U);
       const uint16_t ctx1 = c0 | (c4 & 0xffU) << 8U;
-      const uint16_t ctx2 = c0 ^finalize64(hash(c4 & 0xffffU), 16);
-      const uint16_t ctx3 = c0 ^finalize64(hash(c4 & 0xffffffU), 16);
+      const uint16_t ctx2 = c0 ^ order2Hash;
+      const uint16_t ctx3 = c0 ^ order3Hash;
+      const uint16_t ctx4 = (stats->Match.expectedByte << 8U) | (c4 & 0xffu);
+      pr = Generic.APM1s[0].p(pr0, ctx0);
       pr1 = Generic.APM1s[1].p(pr0, ctx1);
       pr2 = Generic.APM1s[2].p(pr0, ctx2);
       pr3 = Generic.APM1s[3].p(pr0, ctx3);
 
       pr0 = (pr0 + pr1 + pr2 + pr3 + 2) >> 2U;
-      pr1 = Generic.APM1s[4].p(pr, (stats->Match.expectedByte << 8U) | (c4 & 0xffu));
+      pr1 = Generic.APM1s[4].p(pr, ctx4);
       pr2 = Generic.APM1s[5].p(pr, ctx2);
       pr3 = Generic.APM1s[6].p(pr, ctx3);
 
@@ -29,6 +29,9 @@ private:
     struct {
         APM1 APM1s[7];
     } Generic;
+    uint32_t hashedBytes = 0xffffffffU; /**< the last 3 bytes (c4 & 0xffffff) that order2Hash and order3Hash belong to */
+    uint16_t order2Hash = 0; /**< hashes of the last 2 and 3 bytes: they change only at byte boundaries */
+    uint16_t order3Hash = 0;
 
 public:
     explicit  SSE(ModelStats *st);
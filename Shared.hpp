@@ -26,12 +26,23 @@ public:
     uint8_t level = 0; /**< level=0: no compression (only transformations), 1..12 compress using less..more RAM */
     uint64_t mem = 0; /**< pre-calculated value of 65536 * 2^level */
     bool toScreen = true; /**< default value, overridden at instatiation */
+    bool contextMapArena = false; /**< the large ContextMap2 instances share one BucketArena (compression switch "m") */
+    uint8_t idleModelRelease = 0; /**< release the block type specific models after 2^(idleModelRelease-1) MB without their block type, 0: never (-release) */
+    bool modelSelection = false; /**< the optional models are picked per block and signaled by MODELMASK blocks (compression switch "p") */
+    uint8_t zlibThreads = 0; /**< threads of the zlib parameter search, 0: one per core (-zlibthreads) */
+    bool fastVerify = false; /**< transforms that verify themselves while encoding skip the decode-and-compare pass (-fastverify) */
     UpdateBroadcaster *updateBroadcaster = UpdateBroadcaster::getInstance();
 
     static auto getInstance() -> Shared *;
     void update();
     void reset();
     void setLevel(uint8_t level);
+
+    /**
+     * Determine if output is redirected
+     * @return
+     */
+    static auto isOutputDirected() -> bool;
 private:
     Shared() = default;
 
@@ -45,12 +56,6 @@ private:
      */
     auto operator=(Shared const & /*unused*/) -> Shared & { return *this; }
 
-    /**
-     * Determine if output is redirected
-     * @return
-     */
-    static auto isOutputDirected() -> bool;
-
     static Shared *mPInstance;
 };
 
@@ -17,13 +17,13 @@ private:
      * Define padding requirements.
      */
     [[nodiscard]] constexpr inline auto simdWidth() const -> int {
-      if( simd == SIMD_AVX2 ) {
+      if constexpr( simd == SIMD_AVX2 ) {
         return 32 / sizeof(short); // 256 bit (32 byte) data size
       }
-      else if( simd == SIMD_SSE2 || simd == SIMD_SSSE3 || simd == SIMD_NEON ) {
+      else if constexpr( simd == SIMD_SSE2 || simd == SIMD_SSSE3 || simd == SIMD_NEON ) {
         return 16 / sizeof(short); // 128 bit (16 byte) data size
       }
-      else if( simd == SIMD_NONE ) {
+      else if constexpr( simd == SIMD_NONE ) {
         return 4 / sizeof(short); // Processes 2 shorts at once -> width is 4 bytes
       }
       assert(false);
@@ -61,16 +61,16 @@ public:
       if( nx > 0 ) {
         for( uint64_t i = 0; i < numContexts; ++i ) {
           const int err = target - pr[i];
-          if( simd == SIMD_NONE ) {
+          if constexpr( simd == SIMD_NONE ) {
             trainSimdNone(&tx[0], &wx[cxt[i] * n], nx, err * rates[i]);
           }
-          else if( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
+          else if constexpr( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
             trainSimdSse2(&tx[0], &wx[cxt[i] * n], nx, err * rates[i]);
           }
-          else if( simd == SIMD_AVX2 ) {
+          else if constexpr( simd == SIMD_AVX2 ) {
             trainSimdAvx2(&tx[0], &wx[cxt[i] * n], nx, err * rates[i]);
           }
-          else if (simd == SIMD_NEON) {
+          else if constexpr( simd == SIMD_NEON ) {
             trainSimdNeon(&tx[0], &wx[cxt[i] * n], nx, err * rates[i]);
           }
           if((shared->options & OPTION_ADAPTIVE) != 0u ) {
@@ -113,16 +113,16 @@ public:
       if( mp ) { // combine outputs
         for( uint64_t i = 0; i < numContexts; ++i ) {
           int dp = 0;
-          if( simd == SIMD_NONE ) {
+          if constexpr( simd == SIMD_NONE ) {
             dp = dotProductSimdNone(&tx[0], &wx[cxt[i] * n], nx);
           }
-          else if( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
+          else if constexpr( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
             dp = dotProductSimdSse2(&tx[0], &wx[cxt[i] * n], nx);
           }
-          else if( simd == SIMD_AVX2 ) {
+          else if constexpr( simd == SIMD_AVX2 ) {
             dp = dotProductSimdAvx2(&tx[0], &wx[cxt[i] * n], nx);
           }
-          else if (simd == SIMD_NEON) {
+          else if constexpr( simd == SIMD_NEON ) {
             dp = dotProductSimdNeon(&tx[0], &wx[cxt[i] * n], nx);
           }
           dp = (dp * scaleFactor) >> 16U;
@@ -138,16 +138,16 @@ public:
         return mp->p();
       } // s=1 context
       int dp = 0;
-      if( simd == SIMD_NONE ) {
+      if constexpr( simd == SIMD_NONE ) {
         dp = dotProductSimdNone(&tx[0], &wx[cxt[0] * n], nx);
       }
-      else if( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
+      else if constexpr( simd == SIMD_SSE2 || simd == SIMD_SSSE3 ) {
         dp = dotProductSimdSse2(&tx[0], &wx[cxt[0] * n], nx);
       }
-      else if( simd == SIMD_AVX2 ) {
+      else if constexpr( simd == SIMD_AVX2 ) {
         dp = dotProductSimdAvx2(&tx[0], &wx[cxt[0] * n], nx);
       }
-      else if (simd == SIMD_NEON) {
+      else if constexpr( simd == SIMD_NEON ) {
         dp = dotProductSimdNeon(&tx[0], &wx[cxt[0] * n], nx);
       }
       dp = (dp * scaleFactor) >> 16U;
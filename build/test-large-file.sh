@@ -0,0 +1,27 @@
+#!/bin/bash
+# Round trip of a sparse file larger than 4 GB: file sizes, block sizes and positions must not be truncated to 32 bits.
+# Usage (e.g. after build-linux.sh): ./test-large-file.sh ./paq8px [LEVEL ...]
+# The default levels are 0 (transforms only) and 1. From level 1 on every byte goes through the models, which takes hours.
+# The files are created in $TMPDIR (default /tmp): the input is sparse, the archive is small, the output needs 4.5 GB.
+set -e
+
+PAQ8PX=$(readlink -f "${1:?Usage: $0 PAQ8PX [LEVEL ...]}")
+shift
+LEVELS=${*:-0 1}
+DIR=$(mktemp -d)
+trap 'rm -rf "$DIR"' EXIT
+
+# zeros with some text at the beginning, across the 4 GB boundary and at the end
+truncate -s 4500M "$DIR/large.bin"
+for offset in 0 4194000 4607000; do # KB
+  seq 100000 | dd of="$DIR/large.bin" bs=1K seek=$offset conv=notrunc status=none
+done
+
+for level in $LEVELS; do
+  echo "Level $level..."
+  "$PAQ8PX" -$level "$DIR/large.bin" "$DIR/large.paq" > "$DIR/log" 2>&1 || { cat "$DIR/log"; exit 1; }
+  "$PAQ8PX" -d "$DIR/large.paq" "$DIR/large.out" > "$DIR/log" 2>&1 || { cat "$DIR/log"; exit 1; }
+  cmp "$DIR/large.bin" "$DIR/large.out"
+  rm -f "$DIR/large.paq" "$DIR/large.out"
+  echo "Level $level: OK"
+done
@@ -32,6 +32,10 @@ public:
     virtual void setEnd() = 0;
     virtual auto curPos() -> uint64_t = 0;
     virtual auto eof() -> bool = 0;
+    /**
+     * @return false for sequential streams where setpos() and setEnd() are not available
+     */
+    virtual auto isSeekable() -> bool { return true; }
 };
 
 #endif //PAQ8PX_FILE_HPP
@@ -13,12 +13,17 @@ auto FileDisk::makeTmpFile() -> FILE * {
 
 FileDisk::FileDisk() { file = nullptr; }
 
+void FileDisk::setBuffer() { setvbuf(file, nullptr, _IOFBF, BUFFER_SIZE); }
+
 FileDisk::~FileDisk() { close(); }
 
 auto FileDisk::open(const char *filename, bool mustSucceed) -> bool {
   assert(file == nullptr);
   file = openFile(filename, READ);
   const bool success = (file != nullptr);
+  if( success ) {
+    setBuffer();
+  }
   if( !success && mustSucceed ) {
     printf("Unable to open file %s (%s)", filename, strerror(errno));
     quit();
@@ -34,6 +39,7 @@ void FileDisk::create(const char *filename) {
     printf("Unable to create file %s (%s)", filename, strerror(errno));
     quit();
   }
+  setBuffer();
 }
 
 void FileDisk::createTmp() {
@@ -43,6 +49,7 @@ void FileDisk::createTmp() {
     printf("Unable to create temporary file (%s)", strerror(errno));
     quit();
   }
+  setBuffer();
 }
 
 void FileDisk::close() {
@@ -52,9 +59,9 @@ void FileDisk::close() {
   file = nullptr;
 }
 
-auto FileDisk::getchar() -> int { return fgetc(file); }
+auto FileDisk::getchar() -> int { return getc_unlocked(file); }
 
-void FileDisk::putChar(uint8_t c) { fputc(c, file); }
+void FileDisk::putChar(uint8_t c) { putc_unlocked(c, file); }
 
 auto FileDisk::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t { return fread(ptr, 1, count, file); }
 
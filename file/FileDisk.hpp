@@ -6,7 +6,7 @@
 
 /**
  * This class is responsible for files on disk.
- * It simply passes function calls to stdio.
+ * It simply passes function calls to stdio (with a large buffer and without locking for the per-byte calls).
  */
 class FileDisk : public File {
 private:
@@ -23,6 +23,12 @@ private:
     static auto makeTmpFile() -> FILE *;
 protected:
     FILE *file;
+    static constexpr size_t BUFFER_SIZE = 1U << 20U; /**< stdio buffer size: most I/O is done per byte */
+
+    /**
+     * Sets up a large stdio buffer for the opened file
+     */
+    void setBuffer();
 
 public:
     FileDisk();
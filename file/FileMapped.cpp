@@ -0,0 +1,158 @@
+#include "FileMapped.hpp"
+
+#ifdef UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+auto FileMapped::map(const char *filename) -> bool {
+#ifdef WINDOWS
+  fileHandle = CreateFileW(WcharStr(filename).wchar_str, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN,
+                           nullptr);
+  if( fileHandle == INVALID_HANDLE_VALUE ) {
+    return false;
+  }
+  LARGE_INTEGER size;
+  if( GetFileSizeEx(fileHandle, &size) == 0 || size.QuadPart == 0 || static_cast<uint64_t>(size.QuadPart) > SIZE_MAX ) {
+    unmap();
+    return false;
+  }
+  fileSize = size.QuadPart;
+  mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if( mappingHandle != nullptr ) {
+    content = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  }
+#else
+  const int fd = ::open(filename, O_RDONLY);
+  if( fd == -1 ) {
+    return false;
+  }
+  struct stat status {};
+  if( fstat(fd, &status) != 0 || !S_ISREG(status.st_mode) || status.st_size == 0 || static_cast<uint64_t>(status.st_size) > SIZE_MAX ) {
+    ::close(fd);
+    return false;
+  }
+  fileSize = status.st_size;
+  void *p = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file open
+  if( p != MAP_FAILED ) {
+    madvise(p, fileSize, MADV_SEQUENTIAL);
+    content = static_cast<const uint8_t *>(p);
+  }
+#endif
+  if( content == nullptr ) {
+    unmap();
+    return false;
+  }
+  return true;
+}
+
+void FileMapped::unmap() {
+#ifdef WINDOWS
+  if( content != nullptr ) {
+    UnmapViewOfFile(content);
+  }
+  if( mappingHandle != nullptr ) {
+    CloseHandle(mappingHandle);
+  }
+  if( fileHandle != INVALID_HANDLE_VALUE ) {
+    CloseHandle(fileHandle);
+  }
+  mappingHandle = nullptr;
+  fileHandle = INVALID_HANDLE_VALUE;
+#else
+  if( content != nullptr ) {
+    munmap(const_cast<uint8_t *>(content), fileSize);
+  }
+#endif
+  content = nullptr;
+  filePos = 0;
+  fileSize = 0;
+  endReached = false;
+}
+
+FileMapped::FileMapped() : content(nullptr), filePos(0), fileSize(0), endReached(false), fileOnDisk(nullptr) {
+#ifdef WINDOWS
+  fileHandle = INVALID_HANDLE_VALUE;
+  mappingHandle = nullptr;
+#endif
+}
+
+FileMapped::~FileMapped() { close(); }
+
+auto FileMapped::open(const char *filename, bool mustSucceed) -> bool {
+  assert(content == nullptr && fileOnDisk == nullptr);
+  if( map(filename)) {
+    return true;
+  }
+  fileOnDisk = new FileDisk();
+  if( !fileOnDisk->open(filename, mustSucceed)) {
+    delete fileOnDisk;
+    fileOnDisk = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void FileMapped::create(const char * /*filename*/) { assert(false); }
+
+void FileMapped::close() {
+  unmap();
+  if( fileOnDisk != nullptr ) {
+    fileOnDisk->close();
+    delete fileOnDisk;
+    fileOnDisk = nullptr;
+  }
+}
+
+void FileMapped::putChar(uint8_t /*c*/) { assert(false); }
+
+auto FileMapped::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  if( content != nullptr ) {
+    const uint64_t available = filePos < fileSize ? fileSize - filePos : 0;
+    if( available < count ) {
+      count = available;
+      endReached = true;
+    }
+    if( count > 0 ) {
+      memcpy(ptr, &content[filePos], count);
+    }
+    filePos += count;
+    return count;
+  }
+  return fileOnDisk->blockRead(ptr, count);
+}
+
+void FileMapped::blockWrite(uint8_t * /*ptr*/, uint64_t /*count*/) { assert(false); }
+
+void FileMapped::setpos(uint64_t newPos) {
+  if( content != nullptr ) {
+    filePos = newPos;
+    endReached = false;
+    return;
+  }
+  fileOnDisk->setpos(newPos);
+}
+
+void FileMapped::setEnd() {
+  if( content != nullptr ) {
+    filePos = fileSize;
+    endReached = false;
+    return;
+  }
+  fileOnDisk->setEnd();
+}
+
+auto FileMapped::curPos() -> uint64_t {
+  if( content != nullptr ) {
+    return filePos;
+  }
+  return fileOnDisk->curPos();
+}
+
+auto FileMapped::eof() -> bool {
+  if( content != nullptr ) {
+    return endReached;
+  }
+  return fileOnDisk->eof();
+}
@@ -0,0 +1,65 @@
+#ifndef PAQ8PX_FILEMAPPED_HPP
+#define PAQ8PX_FILEMAPPED_HPP
+
+#include "FileDisk.hpp"
+#include "File.hpp"
+
+/**
+ * This class is responsible for reading input files.
+ * The file is mapped into memory, so reading a byte is a simple memory access without any library call.
+ * If the file can not be mapped (e.g. it is empty or too large for the address space) all function calls are passed to a FileDisk.
+ * Writing is forbidden.
+ */
+class FileMapped final : public File {
+private:
+    const uint8_t *content; /**< the mapped file content (nullptr when fileOnDisk is used) */
+    uint64_t filePos;
+    uint64_t fileSize;
+    bool endReached; /**< a read was attempted past the end of file (like feof()) */
+    FileDisk *fileOnDisk;
+#ifdef WINDOWS
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+#endif
+
+    auto map(const char *filename) -> bool;
+    void unmap();
+public:
+    FileMapped();
+    ~FileMapped() override;
+    auto open(const char *filename, bool mustSucceed) -> bool override;
+
+    /**
+     *  This method is forbidden for mapped files.
+     */
+    void create(const char * /*filename*/) override;
+    void close() override;
+
+    auto getchar() -> int override {
+      if( content != nullptr ) {
+        if( filePos < fileSize ) {
+          return content[filePos++];
+        }
+        endReached = true;
+        return EOF;
+      }
+      return fileOnDisk->getchar();
+    }
+
+    /**
+     *  This method is forbidden for mapped files.
+     */
+    void putChar(uint8_t /*c*/) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+
+    /**
+     *  This method is forbidden for mapped files.
+     */
+    void blockWrite(uint8_t * /*ptr*/, uint64_t /*count*/) override;
+    void setpos(uint64_t newPos) override;
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+};
+
+#endif //PAQ8PX_FILEMAPPED_HPP
@@ -0,0 +1,104 @@
+#include "FileStream.hpp"
+
+#ifdef WINDOWS
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+FILE *FileStream::dataOut = nullptr;
+
+FileStream::FileStream() : file(nullptr), position(0) {}
+
+FileStream::~FileStream() { close(); }
+
+auto FileStream::open(const char * /*filename*/, bool /*mustSucceed*/) -> bool {
+  assert(file == nullptr);
+#ifdef WINDOWS
+  _setmode(_fileno(stdin), _O_BINARY);
+#endif
+  file = stdin;
+  position = 0;
+  return true;
+}
+
+void FileStream::create(const char * /*filename*/) {
+  assert(file == nullptr);
+  redirectStdout();
+  file = dataOut;
+  position = 0;
+}
+
+void FileStream::close() {
+  if( file != nullptr && file == dataOut ) {
+    fflush(file);
+  }
+  file = nullptr;
+}
+
+auto FileStream::getchar() -> int {
+  const int c = fgetc(file);
+  if( c != EOF ) {
+    position++;
+  }
+  return c;
+}
+
+void FileStream::putChar(uint8_t c) {
+  fputc(c, file);
+  position++;
+}
+
+auto FileStream::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
+  const uint64_t n = fread(ptr, 1, count, file);
+  position += n;
+  return n;
+}
+
+void FileStream::blockWrite(uint8_t *ptr, uint64_t count) {
+  fwrite(ptr, 1, count, file);
+  position += count;
+}
+
+void FileStream::setpos(uint64_t newPos) {
+  if( newPos == position ) {
+    return;
+  }
+  if( newPos < position || file != stdin ) {
+    quit("Seeking is not supported on a stream.");
+  }
+  while( position < newPos && getchar() != EOF ) {}
+}
+
+void FileStream::setEnd() { quit("Seeking is not supported on a stream."); }
+
+auto FileStream::curPos() -> uint64_t { return position; }
+
+auto FileStream::eof() -> bool { return feof(file) != 0; }
+
+auto FileStream::isSeekable() -> bool { return false; }
+
+auto FileStream::isStream(const char *filename) -> bool { return strcmp(filename, "-") == 0; }
+
+void FileStream::redirectStdout() {
+  if( dataOut != nullptr ) {
+    return;
+  }
+#ifdef WINDOWS
+  const int fd = _dup(_fileno(stdout));
+  if( fd != -1 ) {
+    _setmode(fd, _O_BINARY);
+    dataOut = _fdopen(fd, "wb");
+    _dup2(_fileno(stderr), _fileno(stdout));
+  }
+#else
+  const int fd = dup(fileno(stdout));
+  if( fd != -1 ) {
+    dataOut = fdopen(fd, "wb");
+    dup2(fileno(stderr), fileno(stdout));
+  }
+#endif
+  if( dataOut == nullptr ) {
+    printf("Unable to open standard output (%s)", strerror(errno));
+    quit();
+  }
+}
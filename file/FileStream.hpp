@@ -0,0 +1,56 @@
+#ifndef PAQ8PX_FILESTREAM_HPP
+#define PAQ8PX_FILESTREAM_HPP
+
+#include "File.hpp"
+#include "fileUtils.hpp"
+
+/**
+ * This class is responsible for the standard input and output streams (e.g. pipes).
+ * The stream is sequential: it can not be rewound, and its size is not known in advance.
+ * In a command line a single dash ("-") stands for such a stream.
+ */
+class FileStream : public File {
+private:
+    FILE *file;
+    uint64_t position; /**< number of bytes read or written so far */
+    static FILE *dataOut; /**< the original standard output (see redirectStdout()) */
+public:
+    FileStream();
+    ~FileStream() override;
+    /**
+     * Attaches to the standard input.
+     */
+    auto open(const char * /*filename*/, bool /*mustSucceed*/) -> bool override;
+    /**
+     * Attaches to the standard output (see redirectStdout()).
+     */
+    void create(const char * /*filename*/) override;
+    void close() override;
+    auto getchar() -> int override;
+    void putChar(uint8_t c) override;
+    auto blockRead(uint8_t *ptr, uint64_t count) -> uint64_t override;
+    void blockWrite(uint8_t *ptr, uint64_t count) override;
+    /**
+     * Only skipping forward is supported (when reading).
+     */
+    void setpos(uint64_t newPos) override;
+    /**
+     * This method is forbidden for streams.
+     */
+    void setEnd() override;
+    auto curPos() -> uint64_t override;
+    auto eof() -> bool override;
+    auto isSeekable() -> bool override;
+    /**
+     * @param filename
+     * @return true if @ref filename denotes the standard input or output
+     */
+    static auto isStream(const char *filename) -> bool;
+    /**
+     * Reserves the original standard output for the data stream: from now on everything printed to stdout appears on stderr.
+     * Call it before anything is flushed to stdout (messages still in the stdout buffer will go to stderr as well).
+     */
+    static void redirectStdout();
+};
+
+#endif //PAQ8PX_FILESTREAM_HPP
@@ -100,6 +100,11 @@ auto FileTmp::blockRead(uint8_t *ptr, uint64_t count) -> uint64_t {
 void FileTmp::blockWrite(uint8_t *ptr, uint64_t count) {
   if( contentInRam != nullptr ) {
     if( filePos + count <= MAX_RAM_FOR_TMP_CONTENT ) {
+      if( filePos + count > contentInRam->capacity()) { // grow geometrically (like pushBack()) to avoid reallocating on every block
+        const uint64_t oldSize = contentInRam->size();
+        contentInRam->resize(min(contentInRam->capacity() * 2 + count, static_cast<uint64_t>(MAX_RAM_FOR_TMP_CONTENT)));
+        contentInRam->resize(oldSize);
+      }
       contentInRam->resize((filePos + count));
       if( count > 0 ) {
         memcpy(&((*contentInRam)[filePos]), ptr, count);
@@ -1,6 +1,6 @@
 #include "OpenFromMyFolder.hpp"
 
-void OpenFromMyFolder::myself(FileDisk *f) {
+void OpenFromMyFolder::myself(File *f) {
 #ifdef WINDOWS
   int i;
       Array<wchar_t> myFileName(MAX_PATH);
@@ -29,7 +29,7 @@ void OpenFromMyFolder::myself(FileDisk *f) {
 #endif
 }
 
-void OpenFromMyFolder::anotherFile(FileDisk *f, const char *filename) {
+void OpenFromMyFolder::anotherFile(File *f, const char *filename) {
   const uint64_t fLength = strlen(filename) + 1;
 #ifdef WINDOWS
   int i;
@@ -1,6 +1,7 @@
 #ifndef PAQ8PX_OPENFROMMYFOLDER_HPP
 #define PAQ8PX_OPENFROMMYFOLDER_HPP
 
+#include "File.hpp"
 #include "FileDisk.hpp"
 
 #ifdef __APPLE__
@@ -21,17 +22,17 @@ private:
 public:
     /**
      * This static method will open the executable itself for reading
-     * @param f The @ref FileDisk to read the contents of the file into.
+     * @param f The @ref File to read the contents of the file into.
      */
-    static void myself(FileDisk *f);
+    static void myself(File *f);
 
     /**
      * This static method will open a file from the executable's folder.
      * Only ASCII file names are supported.
-     * @param f The @ref FileDisk to read the contents of the file into.
+     * @param f The @ref File to read the contents of the file into.
      * @param filename The name of the file to open
      */
-    static void anotherFile(FileDisk *f, const char *filename);
+    static void anotherFile(File *f, const char *filename);
 };
 
 #endif //PAQ8PX_OPENFROMMYFOLDER_HPP
@@ -5,7 +5,6 @@
 
 /**
  * Verify that the specified file exists and is readable, determine file size
- * @todo Large file support
  * @param filename
  * @return
  */
@@ -15,9 +14,6 @@ static auto getFileSize(const char *filename) -> uint64_t {
   f.setEnd();
   const auto fileSize = f.curPos();
   f.close();
-  if((fileSize >> 31U) != 0 ) {
-    quit("Large files not supported.");
-  }
   return fileSize;
 }
 
@@ -6,15 +6,20 @@
 #include "../Shared.hpp"
 #include "../file/File.hpp"
 #include "../file/FileDisk.hpp"
+#include "../file/FileMapped.hpp"
+#include "../file/FileStream.hpp"
 #include "../file/FileTmp.hpp"
 #include "../utils.hpp"
 #include "Filter.hpp"
 #include "TextParserStateInfo.hpp"
 #include "base64.hpp"
 #include "cd.hpp"
+#include "dedup.hpp"
 #include "ecc.hpp"
 #include "gif.hpp"
 #include "lzw.hpp"
+#include "lz77.hpp"
+#include "ModelSelection.hpp"
 #include <cctype>
 #include <cstdint>
 #include <cstring>
@@ -113,12 +118,28 @@ static auto isGrayscalePalette(File *in, int n = 256, int isRGBA = 0) -> bool {
   return (res >> 8) > 0;
 }
 
+// The format parsers in detect() work with 32-bit positions, so one call examines at most this many bytes.
+// A larger block is simply continued by the next call (see compressRecursive()).
+static constexpr uint64_t MAX_DETECT_SIZE = 0x7FFFFFFF;
+static constexpr uint32_t DETECT_BUFFER_SIZE = 1U << 16U;
+
+/**
+ * Returns true if the last 4 bytes (@ref buf0) may complete a signature that starts one of the format detectors in detect()
+ * (WAV, AIFF, MOD, S3M, BMP, PBM/PGM/PPM/PAM, RGB, TGA, GIF, PNG, PDF images, base64, JPEG and CD).
+ * The TIFF signature is checked one dword earlier (see detect()).
+ */
+static auto isSignatureEnd(const uint32_t buf0) -> bool {
+  const uint8_t c = buf0 & 0xFF;
+  return c == 0x00 || c == 0x0A || c == 0x10 || c == 0x18 || c == 0x20 || c == ',' || c == '.' || c == '4' || c == '8' || c == '<' ||
+         c == 'F' || c == 'M' || c == 'N' || c == 'R' || c == '[' || c == 'a' || c == 0xDA || (buf0 & 0xFFFFFF00) == 0xFFD8FF00 ||
+         buf0 == 0xFFFFFFFF;
+}
+
 // Detect blocks
 static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> BlockType {
   Shared *shared = Shared::getInstance();
   TextParserStateInfo *textParser = TextParserStateInfo::getInstance();
-  // TODO: Large file support
-  int n = static_cast<int>(blockSize);
+  const int n = static_cast<int>(min(blockSize, MAX_DETECT_SIZE));
   // last 16 bytes
   uint32_t buf3 = 0;
   uint32_t buf2 = 0;
@@ -235,43 +256,100 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
     return DEFAULT;
   }
 
+  // The input is read in bulk: the file position is ahead of the parsers, except where they look at the file themselves
+  Array<uint8_t> inBuf(DETECT_BUFFER_SIZE);
+  uint32_t inBufPos = 0;
+  uint32_t inBufLen = 0;
+  uint64_t inPos = 0; // number of bytes consumed by the parsers
+  auto isGrayscalePaletteAhead = [&](const int paletteSize) -> bool {
+    const uint64_t savedPos = in->curPos();
+    in->setpos(start + inPos);
+    const bool result = isGrayscalePalette(in, paletteSize);
+    in->setpos(savedPos);
+    return result;
+  };
+
+  // Text detection runs behind the other parsers on whole spans of the buffer (it does not see CD sectors).
+  // Whenever it is looked at, and when detect() returns, it must have seen exactly the bytes before the current one.
+  uint32_t textBufPos = 0;
+  uint8_t textPrevByte = 0;
+  auto parseText = [&](const uint32_t end) {
+    if( end > textBufPos ) {
+      if( type != CD ) {
+        textParser->parse(&inBuf[textBufPos], end - textBufPos, inPos - inBufPos + textBufPos,
+                          textBufPos == 0 ? textPrevByte : inBuf[textBufPos - 1]);
+      }
+      textBufPos = end;
+    }
+  };
+  struct ParseTextOnReturn {
+      decltype(parseText) &parse;
+      const uint32_t &bufPos;
+      ~ParseTextOnReturn() {
+        if( bufPos > 0 ) {
+          parse(bufPos - 1);
+        }
+      }
+  } parseTextOnReturn {parseText, inBufPos};
+
   textParser->reset(0);
   for( int i = 0; i < n; ++i ) {
-    int c = in->getchar();
-    if( c == EOF) {
-      return static_cast<BlockType>(-1);
+    if( inBufPos == inBufLen ) {
+      if( inBufLen > 0 ) {
+        parseText(inBufLen);
+        textPrevByte = inBuf[inBufLen - 1];
+        textBufPos = 0;
+      }
+      const uint64_t toRead = inPos < static_cast<uint64_t>(n) ? min(static_cast<uint64_t>(DETECT_BUFFER_SIZE), n - inPos) : DETECT_BUFFER_SIZE;
+      inBufLen = static_cast<uint32_t>(in->blockRead(&inBuf[0], toRead));
+      inBufPos = 0;
+      if( inBufLen == 0 ) {
+        return static_cast<BlockType>(-1);
+      }
     }
+    const int c = inBuf[inBufPos++];
+    inPos++;
     buf3 = buf3 << 8 | buf2 >> 24;
     buf2 = buf2 << 8 | buf1 >> 24;
     buf1 = buf1 << 8 | buf0 >> 24;
     buf0 = buf0 << 8 | c;
 
-    // detect PNG images
-    if((png == 0) && buf3 == 0x89504E47 /*%PNG*/ && buf2 == 0x0D0A1A0A && buf1 == 0x0000000D && buf0 == 0x49484452 ) {
-      png = i, pngType = -1, lastChunk = buf3;
-    }
-    if( png != 0 ) {
-      const int p = i - png;
-      if( p == 12 ) {
-        pngw = buf2;
-        pngh = buf1;
-        pngbps = buf0 >> 24;
-        pngType = static_cast<uint8_t>(buf0 >> 16);
-        pnggray = 0;
-        png *= static_cast<int>((buf0 & 0xFFFF) == 0 && (pngw != 0) && (pngh != 0) && pngbps == 8 &&
-                                ((pngType == 0) || pngType == 2 || pngType == 3 || pngType == 4 || pngType == 6));
-      } else if( p > 12 && pngType < 0 ) {
-        png = 0;
-      } else if( p == 17 ) {
-        png *= static_cast<int>((buf1 & 0xFF) == 0);
-        nextChunk = (png) != 0 ? i + 8 : 0;
-      } else if( p > 17 && i == nextChunk ) {
-        nextChunk += buf1 + 4 /*CRC*/ + 8 /*Chunk length+id*/;
-        lastChunk = buf0;
-        png *= static_cast<int>(lastChunk != 0x49454E44 /*IEND*/);
-        if( lastChunk == 0x504C5445 /*PLTE*/) {
-          png *= static_cast<int>(buf1 % 3 == 0);
-          pnggray = static_cast<int>((png != 0) && isGrayscalePalette(in, buf1 / 3));
+    // Most bytes neither end the signature of a format nor belong to a format being parsed: the format detectors are skipped
+    // for them. The zlib, EXE and text detectors keep state on every byte, they are never skipped.
+    bool idle = type == DEFAULT && i != 0 && !isSignatureEnd(buf0) && (buf1 & 0xFF) != 0 /*TIFF*/ && bmpi == 0 && dibi == 0 &&
+                (png | soi | pgm | rgbi | tga | gif | cdi | pdfIm | b64S) == 0;
+#ifndef DISABLE_AUDIOMODEL
+    idle = idle && (wavi | aiff | s3mi) == 0;
+#endif //  DISABLE_AUDIOMODEL
+
+    if( !idle ) {
+      // detect PNG images
+      if((png == 0) && buf3 == 0x89504E47 /*%PNG*/ && buf2 == 0x0D0A1A0A && buf1 == 0x0000000D && buf0 == 0x49484452 ) {
+        png = i, pngType = -1, lastChunk = buf3;
+      }
+      if( png != 0 ) {
+        const int p = i - png;
+        if( p == 12 ) {
+          pngw = buf2;
+          pngh = buf1;
+          pngbps = buf0 >> 24;
+          pngType = static_cast<uint8_t>(buf0 >> 16);
+          pnggray = 0;
+          png *= static_cast<int>((buf0 & 0xFFFF) == 0 && (pngw != 0) && (pngh != 0) && pngbps == 8 &&
+                                  ((pngType == 0) || pngType == 2 || pngType == 3 || pngType == 4 || pngType == 6));
+        } else if( p > 12 && pngType < 0 ) {
+          png = 0;
+        } else if( p == 17 ) {
+          png *= static_cast<int>((buf1 & 0xFF) == 0);
+          nextChunk = (png) != 0 ? i + 8 : 0;
+        } else if( p > 17 && i == nextChunk ) {
+          nextChunk += buf1 + 4 /*CRC*/ + 8 /*Chunk length+id*/;
+          lastChunk = buf0;
+          png *= static_cast<int>(lastChunk != 0x49454E44 /*IEND*/);
+          if( lastChunk == 0x504C5445 /*PLTE*/) {
+            png *= static_cast<int>(buf1 % 3 == 0);
+            pnggray = static_cast<int>((png != 0) && isGrayscalePaletteAhead(buf1 / 3));
+          }
         }
       }
     }
@@ -290,7 +368,8 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
     bool valid = (i >= 31 && zh != -1);
     if( !valid && shared->options & OPTION_BRUTE && i >= 255 ) {
       uint8_t bType = (zBuf[zBufPos] & 7) >> 1;
-      if((valid = (bType == 1 || bType == 2))) {
+      // reject the candidates (most of the dynamic Huffman ones) that inflate would fail on anyway, before the costlier checks
+      if((valid = (bType == 1 || bType == 2) && isPlausibleDeflateHeader(&zBuf[zBufPos]))) {
         int maximum = 0, used = 0, offset = zBufPos;
         for( int i = 0; i < 4; i++, offset += 64 ) {
           for( int j = 0; j < 64; j++ ) {
@@ -390,717 +469,721 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
     }
 #endif //DISABLE_ZLIB
 
-    if( i - pdfimp > 1024 ) {
-      pdfIm = pdfImW = pdfImH = pdfImB = pdfGray = 0; // fail
-    }
-    if( pdfIm > 1 && !((isspace(c) != 0) || (isdigit(c) != 0))) {
-      pdfIm = 1;
-    }
-    if( pdfIm == 2 && (isdigit(c) != 0)) {
-      pdfImW = pdfImW * 10 + (c - '0');
-    }
-    if( pdfIm == 3 && (isdigit(c) != 0)) {
-      pdfImH = pdfImH * 10 + (c - '0');
-    }
-    if( pdfIm == 4 && (isdigit(c) != 0)) {
-      pdfImB = pdfImB * 10 + (c - '0');
-    }
-    if((buf0 & 0xffff) == 0x3c3c ) {
-      pdfimp = i, pdfIm = 1; // <<
-    }
-    if((pdfIm != 0) && (buf1 & 0xffff) == 0x2f57 && buf0 == 0x69647468 ) {
-      pdfIm = 2, pdfImW = 0; // /Width
-    }
-    if((pdfIm != 0) && (buf1 & 0xffffff) == 0x2f4865 && buf0 == 0x69676874 ) {
-      pdfIm = 3, pdfImH = 0; // /Height
-    }
-    if((pdfIm != 0) && buf3 == 0x42697473 && buf2 == 0x50657243 && buf1 == 0x6f6d706f && buf0 == 0x6e656e74 &&
-       zBuf[(zBufPos - 32 + 15) & 0xFF] == '/' ) {
-      pdfIm = 4, pdfImB = 0; // /BitsPerComponent
-    }
-    if((pdfIm != 0) && (buf2 & 0xFFFFFF) == 0x2F4465 && buf1 == 0x76696365 && buf0 == 0x47726179 ) {
-      pdfGray = 1; // /DeviceGray
-    }
+    if( !idle ) {
+      if( i - pdfimp > 1024 ) {
+        pdfIm = pdfImW = pdfImH = pdfImB = pdfGray = 0; // fail
+      }
+      if( pdfIm > 1 && !((isspace(c) != 0) || (isdigit(c) != 0))) {
+        pdfIm = 1;
+      }
+      if( pdfIm == 2 && (isdigit(c) != 0)) {
+        pdfImW = pdfImW * 10 + (c - '0');
+      }
+      if( pdfIm == 3 && (isdigit(c) != 0)) {
+        pdfImH = pdfImH * 10 + (c - '0');
+      }
+      if( pdfIm == 4 && (isdigit(c) != 0)) {
+        pdfImB = pdfImB * 10 + (c - '0');
+      }
+      if((buf0 & 0xffff) == 0x3c3c ) {
+        pdfimp = i, pdfIm = 1; // <<
+      }
+      if((pdfIm != 0) && (buf1 & 0xffff) == 0x2f57 && buf0 == 0x69647468 ) {
+        pdfIm = 2, pdfImW = 0; // /Width
+      }
+      if((pdfIm != 0) && (buf1 & 0xffffff) == 0x2f4865 && buf0 == 0x69676874 ) {
+        pdfIm = 3, pdfImH = 0; // /Height
+      }
+      if((pdfIm != 0) && buf3 == 0x42697473 && buf2 == 0x50657243 && buf1 == 0x6f6d706f && buf0 == 0x6e656e74 &&
+         zBuf[(zBufPos - 32 + 15) & 0xFF] == '/' ) {
+        pdfIm = 4, pdfImB = 0; // /BitsPerComponent
+      }
+      if((pdfIm != 0) && (buf2 & 0xFFFFFF) == 0x2F4465 && buf1 == 0x76696365 && buf0 == 0x47726179 ) {
+        pdfGray = 1; // /DeviceGray
+      }
 
-    // CD sectors detection (mode 1 and mode 2 form 1+2 - 2352 bytes)
-    if( buf1 == 0x00ffffff && buf0 == 0xffffffff && (cdi == 0)) {
-      cdi = i, cda = -1, cdm = 0;
-    }
-    if((cdi != 0) && i > cdi ) {
-      const int p = (i - cdi) % 2352;
-      if( p == 8 && (buf1 != 0xffffff00 || ((buf0 & 0xff) != 1 && (buf0 & 0xff) != 2))) {
-        cdi = 0;
-      } else if( p == 16 && i + 2336 < n ) {
-        uint8_t data[2352];
-        const uint64_t savedPos = in->curPos();
-        in->setpos(start + i - 23);
-        in->blockRead(data, 2352);
-        in->setpos(savedPos);
-        int t = CdFilter::expandCdSector(data, cda, 1);
-        if( t != cdm ) {
-          cdm = t * static_cast<int>(i - cdi < 2352);
-        }
-        if((cdm != 0) && cda != 10 && (cdm == 1 || buf0 == buf1)) {
-          if( type != CD ) {
-            return info = cdm, in->setpos(start + cdi - 7), CD;
-          }
-          cda = (data[12] << 16) + (data[13] << 8) + data[14];
-          if( cdm != 1 && i - cdi > 2352 && buf0 != cdf ) {
-            cda = 10;
+      // CD sectors detection (mode 1 and mode 2 form 1+2 - 2352 bytes)
+      if( buf1 == 0x00ffffff && buf0 == 0xffffffff && (cdi == 0)) {
+        cdi = i, cda = -1, cdm = 0;
+      }
+      if((cdi != 0) && i > cdi ) {
+        const int p = (i - cdi) % 2352;
+        if( p == 8 && (buf1 != 0xffffff00 || ((buf0 & 0xff) != 1 && (buf0 & 0xff) != 2))) {
+          cdi = 0;
+        } else if( p == 16 && i + 2336 < n ) {
+          uint8_t data[2352];
+          const uint64_t savedPos = in->curPos();
+          in->setpos(start + i - 23);
+          in->blockRead(data, 2352);
+          in->setpos(savedPos);
+          int t = CdFilter::expandCdSector(data, cda, 1);
+          if( t != cdm ) {
+            cdm = t * static_cast<int>(i - cdi < 2352);
           }
-          if( cdm != 1 ) {
-            cdf = buf0;
+          if((cdm != 0) && cda != 10 && (cdm == 1 || buf0 == buf1)) {
+            if( type != CD ) {
+              return info = cdm, in->setpos(start + cdi - 7), CD;
+            }
+            cda = (data[12] << 16) + (data[13] << 8) + data[14];
+            if( cdm != 1 && i - cdi > 2352 && buf0 != cdf ) {
+              cda = 10;
+            }
+            if( cdm != 1 ) {
+              cdf = buf0;
+            }
+          } else {
+            cdi = 0;
           }
-        } else {
-          cdi = 0;
+        }
+        if((cdi == 0) && type == CD ) {
+          in->setpos(start + i - p - 7);
+          return DEFAULT;
         }
       }
-      if((cdi == 0) && type == CD ) {
-        in->setpos(start + i - p - 7);
-        return DEFAULT;
+      if( type == CD ) {
+        continue;
       }
-    }
-    if( type == CD ) {
-      continue;
-    }
 
-    // Detect JPEG by code SOI APPx (FF D8 FF Ex) followed by
-    // SOF0 (FF C0 xx xx 08) and SOS (FF DA) within a reasonable distance.
-    // Detect end by any code other than RST0-RST7 (FF D9-D7) or
-    // a byte stuff (FF 00).
+      // Detect JPEG by code SOI APPx (FF D8 FF Ex) followed by
+      // SOF0 (FF C0 xx xx 08) and SOS (FF DA) within a reasonable distance.
+      // Detect end by any code other than RST0-RST7 (FF D9-D7) or
+      // a byte stuff (FF 00).
 
-    if((soi == 0) && i >= 3 && (buf0 & 0xffffff00) == 0xffd8ff00 && ((buf0 & 0xFE) == 0xC0 || static_cast<uint8_t>(buf0) == 0xC4 ||
-                                                                     (static_cast<uint8_t>(buf0) >= 0xDB &&
-                                                                      static_cast<uint8_t>(buf0) <= 0xFE))) {
-      soi = i, app = i + 2, sos = sof = 0;
-    }
-    if( soi != 0 ) {
-      if( app == i && (buf0 >> 24) == 0xff && ((buf0 >> 16) & 0xff) > 0xc1 && ((buf0 >> 16) & 0xff) < 0xff ) {
-        app = i + (buf0 & 0xffff) + 2;
-      }
-      if( app < i && (buf1 & 0xff) == 0xff && (buf0 & 0xfe0000ff) == 0xc0000008 ) {
-        sof = i;
+      if((soi == 0) && i >= 3 && (buf0 & 0xffffff00) == 0xffd8ff00 && ((buf0 & 0xFE) == 0xC0 || static_cast<uint8_t>(buf0) == 0xC4 ||
+                                                                       (static_cast<uint8_t>(buf0) >= 0xDB &&
+                                                                        static_cast<uint8_t>(buf0) <= 0xFE))) {
+        soi = i, app = i + 2, sos = sof = 0;
       }
-      if((sof != 0) && sof > soi && i - sof < 0x1000 && (buf0 & 0xffff) == 0xffda ) {
-        sos = i;
-        if( type != JPEG ) {
-          return in->setpos(start + soi - 3), JPEG;
+      if( soi != 0 ) {
+        if( app == i && (buf0 >> 24) == 0xff && ((buf0 >> 16) & 0xff) > 0xc1 && ((buf0 >> 16) & 0xff) < 0xff ) {
+          app = i + (buf0 & 0xffff) + 2;
+        }
+        if( app < i && (buf1 & 0xff) == 0xff && (buf0 & 0xfe0000ff) == 0xc0000008 ) {
+          sof = i;
+        }
+        if((sof != 0) && sof > soi && i - sof < 0x1000 && (buf0 & 0xffff) == 0xffda ) {
+          sos = i;
+          if( type != JPEG ) {
+            return in->setpos(start + soi - 3), JPEG;
+          }
+        }
+        if( i - soi > 0x40000 && (sos == 0)) {
+          soi = 0;
         }
       }
-      if( i - soi > 0x40000 && (sos == 0)) {
-        soi = 0;
+      if( type == JPEG && (sos != 0) && i > sos && (buf0 & 0xff00) == 0xff00 && (buf0 & 0xff) != 0 && (buf0 & 0xf8) != 0xd0 ) {
+        in->setpos(start + inPos);
+        return DEFAULT;
       }
-    }
-    if( type == JPEG && (sos != 0) && i > sos && (buf0 & 0xff00) == 0xff00 && (buf0 & 0xff) != 0 && (buf0 & 0xf8) != 0xd0 ) {
-      return DEFAULT;
-    }
 #ifndef DISABLE_AUDIOMODEL
-    // Detect .wav file header
-    if( buf0 == 0x52494646 ) {
-      wavi = i, wavm = wavLen = 0; //"RIFF"
-    }
-    if( wavi != 0 ) {
-      int p = i - wavi;
-      if( p == 4 ) {
-        wavSize = bswap(buf0); //fileSize
-      } else if( p == 8 ) {
-        wavType = (buf0 == 0x57415645 /*WAVE*/) ? 1 : (buf0 == 0x7366626B /*sfbk*/) ? 2 : 0;
-        if( wavType == 0 ) {
-          wavi = 0;
-        }
-      } else if( wavType != 0 ) {
-        if( wavType == 1 ) {
-          if( p == 16 + wavLen && (buf1 != 0x666d7420 /*"fmt "*/ || ((wavm = bswap(buf0) - 16) & 0xFFFFFFFD) != 0)) {
-            wavLen = ((bswap(buf0) + 1) & (-2)) + 8, wavi *= static_cast<int>(buf1 == 0x666d7420 /*"fmt "*/ && (wavm & 0xFFFFFFFD) != 0);
-          } else if( p == 22 + wavLen ) {
-            wavch = bswap(buf0) & 0xffff; // number of channels: 1 or 2
-          } else if( p == 34 + wavLen ) {
-            wavbps = bswap(buf0) & 0xffff; // bits per sample: 8 or 16
-          } else if( p == 40 + wavLen + wavm && buf1 != 0x64617461 /*"data"*/) {
-            wavm += ((bswap(buf0) + 1) & (-2)) + 8, wavi = (wavm > 0xfffff ? 0 : wavi);
-          } else if( p == 40 + wavLen + wavm ) {
-            int wavD = bswap(buf0); // size of data section
-            wavLen = 0;
-            if((wavch == 1 || wavch == 2) && (wavbps == 8 || wavbps == 16) && wavD > 0 && wavSize >= wavD + 36 &&
-               wavD % ((wavbps / 8) * wavch) == 0 ) {
-              AUD_DET((wavbps == 8) ? AUDIO : AUDIO_LE, wavi - 3, 44 + wavm, wavD, wavch + wavbps / 4 - 3);
-            }
+      // Detect .wav file header
+      if( buf0 == 0x52494646 ) {
+        wavi = i, wavm = wavLen = 0; //"RIFF"
+      }
+      if( wavi != 0 ) {
+        int p = i - wavi;
+        if( p == 4 ) {
+          wavSize = bswap(buf0); //fileSize
+        } else if( p == 8 ) {
+          wavType = (buf0 == 0x57415645 /*WAVE*/) ? 1 : (buf0 == 0x7366626B /*sfbk*/) ? 2 : 0;
+          if( wavType == 0 ) {
             wavi = 0;
           }
-        } else {
-          if((p == 16 && buf1 != 0x4C495354 /*LIST*/) || (p == 20 && buf0 != 0x494E464F /*INFO*/)) {
-            wavi = 0;
-          } else if( p > 20 && buf1 == 0x4C495354 /*LIST*/ && ((wavi *= static_cast<int>(buf0 != 0)) != 0)) {
-            wavLen = bswap(buf0);
-            wavlist = i;
-          } else if( wavlist != 0 ) {
-            p = i - wavlist;
-            if( p == 8 && (buf1 != 0x73647461 /*sdta*/ || buf0 != 0x736D706C /*smpl*/)) {
-              wavi = 0;
-            } else if( p == 12 ) {
-              int wavD = bswap(buf0);
-              if((wavD != 0) && (wavD + 12) == wavLen ) {
-                AUD_DET(AUDIO_LE, wavi - 3, (12 + wavlist - (wavi - 3) + 1) & ~1, wavD, 1 + 16 / 4 - 3 /*mono, 16-bit*/);
+        } else if( wavType != 0 ) {
+          if( wavType == 1 ) {
+            if( p == 16 + wavLen && (buf1 != 0x666d7420 /*"fmt "*/ || ((wavm = bswap(buf0) - 16) & 0xFFFFFFFD) != 0)) {
+              wavLen = ((bswap(buf0) + 1) & (-2)) + 8, wavi *= static_cast<int>(buf1 == 0x666d7420 /*"fmt "*/ && (wavm & 0xFFFFFFFD) != 0);
+            } else if( p == 22 + wavLen ) {
+              wavch = bswap(buf0) & 0xffff; // number of channels: 1 or 2
+            } else if( p == 34 + wavLen ) {
+              wavbps = bswap(buf0) & 0xffff; // bits per sample: 8 or 16
+            } else if( p == 40 + wavLen + wavm && buf1 != 0x64617461 /*"data"*/) {
+              wavm += ((bswap(buf0) + 1) & (-2)) + 8, wavi = (wavm > 0xfffff ? 0 : wavi);
+            } else if( p == 40 + wavLen + wavm ) {
+              int wavD = bswap(buf0); // size of data section
+              wavLen = 0;
+              if((wavch == 1 || wavch == 2) && (wavbps == 8 || wavbps == 16) && wavD > 0 && wavSize >= wavD + 36 &&
+                 wavD % ((wavbps / 8) * wavch) == 0 ) {
+                AUD_DET((wavbps == 8) ? AUDIO : AUDIO_LE, wavi - 3, 44 + wavm, wavD, wavch + wavbps / 4 - 3);
               }
               wavi = 0;
             }
+          } else {
+            if((p == 16 && buf1 != 0x4C495354 /*LIST*/) || (p == 20 && buf0 != 0x494E464F /*INFO*/)) {
+              wavi = 0;
+            } else if( p > 20 && buf1 == 0x4C495354 /*LIST*/ && ((wavi *= static_cast<int>(buf0 != 0)) != 0)) {
+              wavLen = bswap(buf0);
+              wavlist = i;
+            } else if( wavlist != 0 ) {
+              p = i - wavlist;
+              if( p == 8 && (buf1 != 0x73647461 /*sdta*/ || buf0 != 0x736D706C /*smpl*/)) {
+                wavi = 0;
+              } else if( p == 12 ) {
+                int wavD = bswap(buf0);
+                if((wavD != 0) && (wavD + 12) == wavLen ) {
+                  AUD_DET(AUDIO_LE, wavi - 3, (12 + wavlist - (wavi - 3) + 1) & ~1, wavD, 1 + 16 / 4 - 3 /*mono, 16-bit*/);
+                }
+                wavi = 0;
+              }
+            }
           }
         }
       }
-    }
-
-    // Detect .aiff file header
-    if( buf0 == 0x464f524d ) {
-      aiff = i, aiffs = 0; // FORM
-    }
-    if( aiff != 0 ) {
-      const int p = i - aiff;
-      if( p == 12 && (buf1 != 0x41494646 || buf0 != 0x434f4d4d)) {
-        aiff = 0; // AIFF COMM
-      } else if( p == 24 ) {
-        const int bits = buf0 & 0xffff;
-        const int chn = buf1 >> 16;
-        if((bits == 8 || bits == 16) && (chn == 1 || chn == 2)) {
-          aiffm = chn + bits / 4 - 3 + 4;
-        } else {
-          aiff = 0;
-        }
-      } else if( p == 42 + aiffs && buf1 != 0x53534e44 ) {
-        aiffs += (buf0 + 8) + (buf0 & 1), aiff = (aiffs > 0x400 ? 0 : aiff);
-      } else if( p == 42 + aiffs ) {
-        AUD_DET(AUDIO, aiff - 3, 54 + aiffs, buf0 - 8, aiffm);
-      }
-    }
 
-    // Detect .mod file header
-    if((buf0 == 0x4d2e4b2e || buf0 == 0x3643484e || buf0 == 0x3843484e // m.K. 6CHN 8CHN
-        || buf0 == 0x464c5434 || buf0 == 0x464c5438) && (buf1 & 0xc0c0c0c0) == 0 && i >= 1083 ) {
-      const uint64_t savedPos = in->curPos();
-      const int chn = ((buf0 >> 24) == 0x36 ? 6 : (((buf0 >> 24) == 0x38 || (buf0 & 0xff) == 0x38) ? 8 : 4));
-      int len = 0; // total length of samples
-      int numPat = 1; // number of patterns
-      for( int j = 0; j < 31; j++ ) {
-        in->setpos(start + i - 1083 + 42 + j * 30);
-        const int i1 = in->getchar();
-        const int i2 = in->getchar();
-        len += i1 * 512 + i2 * 2;
+      // Detect .aiff file header
+      if( buf0 == 0x464f524d ) {
+        aiff = i, aiffs = 0; // FORM
       }
-      in->setpos(start + i - 131);
-      for( int j = 0; j < 128; j++ ) {
-        int x = in->getchar();
-        if( x + 1 > numPat ) {
-          numPat = x + 1;
+      if( aiff != 0 ) {
+        const int p = i - aiff;
+        if( p == 12 && (buf1 != 0x41494646 || buf0 != 0x434f4d4d)) {
+          aiff = 0; // AIFF COMM
+        } else if( p == 24 ) {
+          const int bits = buf0 & 0xffff;
+          const int chn = buf1 >> 16;
+          if((bits == 8 || bits == 16) && (chn == 1 || chn == 2)) {
+            aiffm = chn + bits / 4 - 3 + 4;
+          } else {
+            aiff = 0;
+          }
+        } else if( p == 42 + aiffs && buf1 != 0x53534e44 ) {
+          aiffs += (buf0 + 8) + (buf0 & 1), aiff = (aiffs > 0x400 ? 0 : aiff);
+        } else if( p == 42 + aiffs ) {
+          AUD_DET(AUDIO, aiff - 3, 54 + aiffs, buf0 - 8, aiffm);
         }
       }
-      if( numPat < 65 ) {
-        AUD_DET(AUDIO, i - 1083, 1084 + numPat * 256 * chn, len, 4 /*mono, 8-bit*/);
-      }
-      in->setpos(savedPos);
-    }
 
-    // Detect .s3m file header
-    if( buf0 == 0x1a100000 ) {
-      s3mi = i, s3Mno = s3Mni = 0; //0x1A: signature byte, 0x10: song type, 0x0000: reserved
-    }
-    if( s3mi != 0 ) {
-      const int p = i - s3mi;
-      if( p == 4 ) {
-        s3Mno = bswap(buf0) & 0xffff; //Number of entries in the order table, should be even
-        s3Mni = (bswap(buf0) >> 16); //Number of instruments in the song
-      } else if( p == 16 && (((buf1 >> 16) & 0xff) != 0x13 || buf0 != 0x5343524d /*SCRM*/)) {
-        s3mi = 0;
-      } else if( p == 16 ) {
+      // Detect .mod file header
+      if((buf0 == 0x4d2e4b2e || buf0 == 0x3643484e || buf0 == 0x3843484e // m.K. 6CHN 8CHN
+          || buf0 == 0x464c5434 || buf0 == 0x464c5438) && (buf1 & 0xc0c0c0c0) == 0 && i >= 1083 ) {
         const uint64_t savedPos = in->curPos();
-        int b[31];
-        int samStart = (1 << 16);
-        int samEnd = 0;
-        int ok = 1;
-        for( int j = 0; j < s3Mni; j++ ) {
-          in->setpos(start + s3mi - 31 + 0x60 + s3Mno + j * 2);
-          int i1 = in->getchar();
-          i1 += in->getchar() * 256;
-          in->setpos(start + s3mi - 31 + i1 * 16);
-          i1 = in->getchar();
-          if( i1 == 1 ) { // type: sample
-            for( int k = 0; k < 31; k++ ) {
-              b[k] = in->getchar();
-            }
-            int len = b[15] + (b[16] << 8);
-            int ofs = b[13] + (b[14] << 8);
-            if( b[30] > 1 ) {
-              ok = 0;
-            }
-            if( ofs * 16 < samStart ) {
-              samStart = ofs * 16;
-            }
-            if( ofs * 16 + len > samEnd ) {
-              samEnd = ofs * 16 + len;
-            }
+        const int chn = ((buf0 >> 24) == 0x36 ? 6 : (((buf0 >> 24) == 0x38 || (buf0 & 0xff) == 0x38) ? 8 : 4));
+        int len = 0; // total length of samples
+        int numPat = 1; // number of patterns
+        for( int j = 0; j < 31; j++ ) {
+          in->setpos(start + i - 1083 + 42 + j * 30);
+          const int i1 = in->getchar();
+          const int i2 = in->getchar();
+          len += i1 * 512 + i2 * 2;
+        }
+        in->setpos(start + i - 131);
+        for( int j = 0; j < 128; j++ ) {
+          int x = in->getchar();
+          if( x + 1 > numPat ) {
+            numPat = x + 1;
           }
         }
-        if((ok != 0) && samStart < (1 << 16)) {
-          AUD_DET(AUDIO, s3mi - 31, samStart, samEnd - samStart, 0 /*mono, 8-bit*/);
+        if( numPat < 65 ) {
+          AUD_DET(AUDIO, i - 1083, 1084 + numPat * 256 * chn, len, 4 /*mono, 8-bit*/);
         }
-        s3mi = 0;
         in->setpos(savedPos);
       }
-    }
-#endif //  DISABLE_AUDIOMODEL
 
-    // Detect .bmp image
-    if((bmpi == 0u) && (dibi == 0u)) {
-      if((buf0 & 0xffff) == 16973 ) { // 'BM'
-        bmpi = i; // header start: bmpi-1
-        dibi = i - 1 + 18; // we expect a DIB header to come
-      } else if( buf0 == 0x28000000 ) { // headerless (DIB-only)
-        dibi = i + 1;
+      // Detect .s3m file header
+      if( buf0 == 0x1a100000 ) {
+        s3mi = i, s3Mno = s3Mni = 0; //0x1A: signature byte, 0x10: song type, 0x0000: reserved
       }
-    } else {
-      const uint32_t p = i - dibi + 1 + 18;
-      if( p == 10 + 4 ) {
-        bmpof = bswap(buf0), bmpi = (bmpof < 54 || start + blockSize < bmpi - 1 + bmpof) ? (dibi = 0)
-                                                                                         : bmpi; //offset of pixel data (this field is still located in the BMP Header)
-      } else if( p == 14 + 4 && buf0 != 0x28000000 ) {
-        bmpi = dibi = 0; //BITMAPINFOHEADER (0x28)
-      } else if( p == 18 + 4 ) {
-        bmpx = bswap(buf0), bmpi = (((bmpx & 0xff000000) != 0 || bmpx == 0) ? (dibi = 0) : bmpi); //width
-      } else if( p == 22 + 4 ) {
-        bmpy = abs(int(bswap(buf0))), bmpi = (((bmpy & 0xff000000) != 0 || bmpy == 0) ? (dibi = 0) : bmpi); //height
-      } else if( p == 26 + 2 ) {
-        bmpi = ((bswap(buf0 << 16)) != 1) ? (dibi = 0) : bmpi; //number of color planes (must be 1)
-      } else if( p == 28 + 2 ) {
-        imgbpp = bswap(buf0 << 16), bmpi = ((imgbpp != 1 && imgbpp != 4 && imgbpp != 8 && imgbpp != 24 && imgbpp != 32) ? (dibi = 0)
-                                                                                                                        : bmpi); //color depth
-      } else if( p == 30 + 4 ) {
-        bmpi = ((buf0 != 0) ? (dibi = 0) : bmpi); //compression method must be: BI_RGB (uncompressed)
-      } else if( p == 34 + 4 ) {
-        bmps = bswap(buf0); //image size or 0
-        //else if (p==38+4) ; // the horizontal resolution of the image (ignored)
-        //else if (p==42+4) ; // the vertical resolution of the image (ignored)
-      } else if( p == 46 + 4 ) {
-        nColors = bswap(buf0); // the number of colors in the color palette, or 0 to default to (1<<imgbpp)
-        if( nColors == 0 && imgbpp <= 8 ) {
-          nColors = 1 << imgbpp;
+      if( s3mi != 0 ) {
+        const int p = i - s3mi;
+        if( p == 4 ) {
+          s3Mno = bswap(buf0) & 0xffff; //Number of entries in the order table, should be even
+          s3Mni = (bswap(buf0) >> 16); //Number of instruments in the song
+        } else if( p == 16 && (((buf1 >> 16) & 0xff) != 0x13 || buf0 != 0x5343524d /*SCRM*/)) {
+          s3mi = 0;
+        } else if( p == 16 ) {
+          const uint64_t savedPos = in->curPos();
+          int b[31];
+          int samStart = (1 << 16);
+          int samEnd = 0;
+          int ok = 1;
+          for( int j = 0; j < s3Mni; j++ ) {
+            in->setpos(start + s3mi - 31 + 0x60 + s3Mno + j * 2);
+            int i1 = in->getchar();
+            i1 += in->getchar() * 256;
+            in->setpos(start + s3mi - 31 + i1 * 16);
+            i1 = in->getchar();
+            if( i1 == 1 ) { // type: sample
+              for( int k = 0; k < 31; k++ ) {
+                b[k] = in->getchar();
+              }
+              int len = b[15] + (b[16] << 8);
+              int ofs = b[13] + (b[14] << 8);
+              if( b[30] > 1 ) {
+                ok = 0;
+              }
+              if( ofs * 16 < samStart ) {
+                samStart = ofs * 16;
+              }
+              if( ofs * 16 + len > samEnd ) {
+                samEnd = ofs * 16 + len;
+              }
+            }
+          }
+          if((ok != 0) && samStart < (1 << 16)) {
+            AUD_DET(AUDIO, s3mi - 31, samStart, samEnd - samStart, 0 /*mono, 8-bit*/);
+          }
+          s3mi = 0;
+          in->setpos(savedPos);
         }
-        if( nColors > (1U << imgbpp) || (imgbpp > 8 && nColors > 0)) {
-          bmpi = dibi = 0;
+      }
+#endif //  DISABLE_AUDIOMODEL
+
+      // Detect .bmp image
+      if((bmpi == 0u) && (dibi == 0u)) {
+        if((buf0 & 0xffff) == 16973 ) { // 'BM'
+          bmpi = i; // header start: bmpi-1
+          dibi = i - 1 + 18; // we expect a DIB header to come
+        } else if( buf0 == 0x28000000 ) { // headerless (DIB-only)
+          dibi = i + 1;
         }
-      } else if( p == 50 + 4 ) { //the number of important colors used
-        if( bswap(buf0) <= nColors || bswap(buf0) == 0x10000000 ) {
-          if( bmpi == 0 /*headerless*/ && (bmpx * 2 == bmpy) && imgbpp > 1 && // possible icon/cursor?
-              ((bmps > 0 && bmps == ((bmpx * bmpy * (imgbpp + 1)) >> 4)) || (((bmps == 0u) || bmps < ((bmpx * bmpy * imgbpp) >> 3)) &&
-                                                                             ((bmpx == 8) || (bmpx == 10) || (bmpx == 14) || (bmpx == 16) ||
-                                                                              (bmpx == 20) || (bmpx == 22) || (bmpx == 24) ||
-                                                                              (bmpx == 32) || (bmpx == 40) || (bmpx == 48) ||
-                                                                              (bmpx == 60) || (bmpx == 64) || (bmpx == 72) ||
-                                                                              (bmpx == 80) || (bmpx == 96) || (bmpx == 128) ||
-                                                                              (bmpx == 256))))) {
-            bmpy = bmpx;
+      } else {
+        const uint32_t p = i - dibi + 1 + 18;
+        if( p == 10 + 4 ) {
+          bmpof = bswap(buf0), bmpi = (bmpof < 54 || start + blockSize < bmpi - 1 + bmpof) ? (dibi = 0)
+                                                                                           : bmpi; //offset of pixel data (this field is still located in the BMP Header)
+        } else if( p == 14 + 4 && buf0 != 0x28000000 ) {
+          bmpi = dibi = 0; //BITMAPINFOHEADER (0x28)
+        } else if( p == 18 + 4 ) {
+          bmpx = bswap(buf0), bmpi = (((bmpx & 0xff000000) != 0 || bmpx == 0) ? (dibi = 0) : bmpi); //width
+        } else if( p == 22 + 4 ) {
+          bmpy = abs(int(bswap(buf0))), bmpi = (((bmpy & 0xff000000) != 0 || bmpy == 0) ? (dibi = 0) : bmpi); //height
+        } else if( p == 26 + 2 ) {
+          bmpi = ((bswap(buf0 << 16)) != 1) ? (dibi = 0) : bmpi; //number of color planes (must be 1)
+        } else if( p == 28 + 2 ) {
+          imgbpp = bswap(buf0 << 16), bmpi = ((imgbpp != 1 && imgbpp != 4 && imgbpp != 8 && imgbpp != 24 && imgbpp != 32) ? (dibi = 0)
+                                                                                                                          : bmpi); //color depth
+        } else if( p == 30 + 4 ) {
+          bmpi = ((buf0 != 0) ? (dibi = 0) : bmpi); //compression method must be: BI_RGB (uncompressed)
+        } else if( p == 34 + 4 ) {
+          bmps = bswap(buf0); //image size or 0
+          //else if (p==38+4) ; // the horizontal resolution of the image (ignored)
+          //else if (p==42+4) ; // the vertical resolution of the image (ignored)
+        } else if( p == 46 + 4 ) {
+          nColors = bswap(buf0); // the number of colors in the color palette, or 0 to default to (1<<imgbpp)
+          if( nColors == 0 && imgbpp <= 8 ) {
+            nColors = 1 << imgbpp;
           }
-
-          BlockType blockType = DEFAULT;
-          uint32_t widthInBytes = 0;
-          if( imgbpp == 1 ) {
-            blockType = IMAGE1;
-            widthInBytes = (((bmpx - 1) >> 5) + 1) * 4;
-          } else if( imgbpp == 4 ) {
-            blockType = IMAGE4;
-            widthInBytes = ((bmpx * 4 + 31) >> 5) * 4;
-          } else if( imgbpp == 8 ) {
-            blockType = IMAGE8;
-            widthInBytes = (bmpx + 3) & -4;
-          } else if( imgbpp == 24 ) {
-            blockType = IMAGE24;
-            widthInBytes = ((bmpx * 3) + 3) & -4;
-          } else if( imgbpp == 32 ) {
-            blockType = IMAGE32;
-            widthInBytes = bmpx * 4;
+          if( nColors > (1U << imgbpp) || (imgbpp > 8 && nColors > 0)) {
+            bmpi = dibi = 0;
           }
+        } else if( p == 50 + 4 ) { //the number of important colors used
+          if( bswap(buf0) <= nColors || bswap(buf0) == 0x10000000 ) {
+            if( bmpi == 0 /*headerless*/ && (bmpx * 2 == bmpy) && imgbpp > 1 && // possible icon/cursor?
+                ((bmps > 0 && bmps == ((bmpx * bmpy * (imgbpp + 1)) >> 4)) || (((bmps == 0u) || bmps < ((bmpx * bmpy * imgbpp) >> 3)) &&
+                                                                               ((bmpx == 8) || (bmpx == 10) || (bmpx == 14) || (bmpx == 16) ||
+                                                                                (bmpx == 20) || (bmpx == 22) || (bmpx == 24) ||
+                                                                                (bmpx == 32) || (bmpx == 40) || (bmpx == 48) ||
+                                                                                (bmpx == 60) || (bmpx == 64) || (bmpx == 72) ||
+                                                                                (bmpx == 80) || (bmpx == 96) || (bmpx == 128) ||
+                                                                                (bmpx == 256))))) {
+              bmpy = bmpx;
+            }
 
-          if( imgbpp == 8 ) {
-            const uint64_t colorPalettePos = dibi - 18 + 54;
-            const uint64_t savedPos = in->curPos();
-            in->setpos(colorPalettePos);
-            if( isGrayscalePalette(in, nColors, 1)) {
-              blockType = IMAGE8GRAY;
+            BlockType blockType = DEFAULT;
+            uint32_t widthInBytes = 0;
+            if( imgbpp == 1 ) {
+              blockType = IMAGE1;
+              widthInBytes = (((bmpx - 1) >> 5) + 1) * 4;
+            } else if( imgbpp == 4 ) {
+              blockType = IMAGE4;
+              widthInBytes = ((bmpx * 4 + 31) >> 5) * 4;
+            } else if( imgbpp == 8 ) {
+              blockType = IMAGE8;
+              widthInBytes = (bmpx + 3) & -4;
+            } else if( imgbpp == 24 ) {
+              blockType = IMAGE24;
+              widthInBytes = ((bmpx * 3) + 3) & -4;
+            } else if( imgbpp == 32 ) {
+              blockType = IMAGE32;
+              widthInBytes = bmpx * 4;
+            }
+
+            if( imgbpp == 8 ) {
+              const uint64_t colorPalettePos = dibi - 18 + 54;
+              const uint64_t savedPos = in->curPos();
+              in->setpos(colorPalettePos);
+              if( isGrayscalePalette(in, nColors, 1)) {
+                blockType = IMAGE8GRAY;
+              }
+              in->setpos(savedPos);
             }
-            in->setpos(savedPos);
-          }
 
-          const uint32_t headerPos = bmpi > 0 ? bmpi - 1 : dibi - 4;
-          const uint32_t minHeaderSize = (bmpi > 0 ? 54 : 54 - 14) + nColors * 4;
-          const uint32_t headerSize = bmpi > 0 ? bmpof : minHeaderSize;
-
-          // some final sanity checks
-          if( bmps != 0 &&
-              bmps < widthInBytes * bmpy ) { /*printf("\nBMP guard: image is larger than reported in header\n",bmps,widthInBytes*bmpy);*/
-          } else if( start + blockSize < headerPos + headerSize + widthInBytes * bmpy ) { /*printf("\nBMP guard: cropped data\n");*/
-          } else if( headerSize == (bmpi > 0 ? 54 : 54 - 14) && nColors > 0 ) { /*printf("\nBMP guard: missing palette\n");*/
-          } else if( bmpi > 0 && bmpof < minHeaderSize ) { /*printf("\nBMP guard: overlapping color palette\n");*/
-          } else if( bmpi > 0 && uint64_t(bmpi) - 1 + bmpof + widthInBytes * bmpy >
-                                 start + blockSize ) { /*printf("\nBMP guard: reported pixel data offset is incorrect\n");*/
-          } else if( widthInBytes * bmpy <= 64 ) { /*printf("\nBMP guard: too small\n");*/
-          } // too small - not worthy to use the image models
-          else {
-            IMG_DET(blockType, headerPos, headerSize, widthInBytes, bmpy);
+            const uint32_t headerPos = bmpi > 0 ? bmpi - 1 : dibi - 4;
+            const uint32_t minHeaderSize = (bmpi > 0 ? 54 : 54 - 14) + nColors * 4;
+            const uint32_t headerSize = bmpi > 0 ? bmpof : minHeaderSize;
+
+            // some final sanity checks
+            if( bmps != 0 &&
+                bmps < widthInBytes * bmpy ) { /*printf("\nBMP guard: image is larger than reported in header\n",bmps,widthInBytes*bmpy);*/
+            } else if( start + blockSize < headerPos + headerSize + widthInBytes * bmpy ) { /*printf("\nBMP guard: cropped data\n");*/
+            } else if( headerSize == (bmpi > 0 ? 54 : 54 - 14) && nColors > 0 ) { /*printf("\nBMP guard: missing palette\n");*/
+            } else if( bmpi > 0 && bmpof < minHeaderSize ) { /*printf("\nBMP guard: overlapping color palette\n");*/
+            } else if( bmpi > 0 && uint64_t(bmpi) - 1 + bmpof + widthInBytes * bmpy >
+                                   start + blockSize ) { /*printf("\nBMP guard: reported pixel data offset is incorrect\n");*/
+            } else if( widthInBytes * bmpy <= 64 ) { /*printf("\nBMP guard: too small\n");*/
+            } // too small - not worthy to use the image models
+            else {
+              IMG_DET(blockType, headerPos, headerSize, widthInBytes, bmpy);
+            }
           }
+          bmpi = dibi = 0;
         }
-        bmpi = dibi = 0;
       }
-    }
 
-    // Detect binary .pbm .pgm .ppm .pam images
-    if((buf0 & 0xfff0ff) == 0x50300a ) { //"Px" + line feed, where "x" shall be a number
-      pgmn = (buf0 & 0xf00) >> 8; // extract "x"
-      if((pgmn >= 4 && pgmn <= 6) || pgmn == 7 ) {
-        pgm = i, pgmPtr = pgmw = pgmh = pgmc = pgmComment = pamatr = pamd = pgmdata = pgmDataSize = 0; // "P4" (pbm), "P5" (pgm), "P6" (ppm), "P7" (pam)
-      }
-    }
-    if( pgm != 0 ) {
-      if( pgmdata == 0 ) { // parse header
-        if( i - pgm == 1 && c == 0x23 ) {
-          pgmComment = 1; // # (pgm comment)
+      // Detect binary .pbm .pgm .ppm .pam images
+      if((buf0 & 0xfff0ff) == 0x50300a ) { //"Px" + line feed, where "x" shall be a number
+        pgmn = (buf0 & 0xf00) >> 8; // extract "x"
+        if((pgmn >= 4 && pgmn <= 6) || pgmn == 7 ) {
+          pgm = i, pgmPtr = pgmw = pgmh = pgmc = pgmComment = pamatr = pamd = pgmdata = pgmDataSize = 0; // "P4" (pbm), "P5" (pgm), "P6" (ppm), "P7" (pam)
         }
-        if((pgmComment == 0) && (pgmPtr != 0)) {
-          int s = 0;
-          if( pgmn == 7 ) {
-            if((buf1 & 0xdfdf) == 0x5749 && (buf0 & 0xdfdfdfff) == 0x44544820 ) {
-              pgmPtr = 0, pamatr = 1; // WIDTH
-            }
-            if((buf1 & 0xdfdfdf) == 0x484549 && (buf0 & 0xdfdfdfff) == 0x47485420 ) {
-              pgmPtr = 0, pamatr = 2; // HEIGHT
-            }
-            if((buf1 & 0xdfdfdf) == 0x4d4158 && (buf0 & 0xdfdfdfff) == 0x56414c20 ) {
-              pgmPtr = 0, pamatr = 3; // MAXVAL
-            }
-            if((buf1 & 0xdfdf) == 0x4445 && (buf0 & 0xdfdfdfff) == 0x50544820 ) {
-              pgmPtr = 0, pamatr = 4; // DEPTH
-            }
-            if((buf2 & 0xdf) == 0x54 && (buf1 & 0xdfdfdfdf) == 0x55504c54 && (buf0 & 0xdfdfdfff) == 0x59504520 ) {
-              pgmPtr = 0, pamatr = 5; // TUPLTYPE
-            }
-            if((buf1 & 0xdfdfdf) == 0x454e44 && (buf0 & 0xdfdfdfff) == 0x4844520a ) {
-              pgmPtr = 0, pamatr = 6; // ENDHDR
+      }
+      if( pgm != 0 ) {
+        if( pgmdata == 0 ) { // parse header
+          if( i - pgm == 1 && c == 0x23 ) {
+            pgmComment = 1; // # (pgm comment)
+          }
+          if((pgmComment == 0) && (pgmPtr != 0)) {
+            int s = 0;
+            if( pgmn == 7 ) {
+              if((buf1 & 0xdfdf) == 0x5749 && (buf0 & 0xdfdfdfff) == 0x44544820 ) {
+                pgmPtr = 0, pamatr = 1; // WIDTH
+              }
+              if((buf1 & 0xdfdfdf) == 0x484549 && (buf0 & 0xdfdfdfff) == 0x47485420 ) {
+                pgmPtr = 0, pamatr = 2; // HEIGHT
+              }
+              if((buf1 & 0xdfdfdf) == 0x4d4158 && (buf0 & 0xdfdfdfff) == 0x56414c20 ) {
+                pgmPtr = 0, pamatr = 3; // MAXVAL
+              }
+              if((buf1 & 0xdfdf) == 0x4445 && (buf0 & 0xdfdfdfff) == 0x50544820 ) {
+                pgmPtr = 0, pamatr = 4; // DEPTH
+              }
+              if((buf2 & 0xdf) == 0x54 && (buf1 & 0xdfdfdfdf) == 0x55504c54 && (buf0 & 0xdfdfdfff) == 0x59504520 ) {
+                pgmPtr = 0, pamatr = 5; // TUPLTYPE
+              }
+              if((buf1 & 0xdfdfdf) == 0x454e44 && (buf0 & 0xdfdfdfff) == 0x4844520a ) {
+                pgmPtr = 0, pamatr = 6; // ENDHDR
+              }
+              if( c == 0x0a ) {
+                if( pamatr == 0 ) {
+                  pgm = 0;
+                } else if( pamatr < 5 ) {
+                  s = pamatr;
+                }
+                if( pamatr != 6 ) {
+                  pamatr = 0;
+                }
+              }
+            } else if( c == 0x20 && (pgmw == 0)) {
+              s = 1;
+            } else if( c == 0x0a && (pgmh == 0)) {
+              s = 2;
+            } else if( c == 0x0a && (pgmc == 0) && pgmn != 4 ) {
+              s = 3;
             }
-            if( c == 0x0a ) {
-              if( pamatr == 0 ) {
-                pgm = 0;
-              } else if( pamatr < 5 ) {
-                s = pamatr;
+            if( s != 0 ) {
+              pgmBuf[pgmPtr++] = 0;
+              int v = atoi(pgmBuf); // parse width/height/depth/maxval value
+              if( s == 1 ) {
+                pgmw = v;
+              } else if( s == 2 ) {
+                pgmh = v;
+              } else if( s == 3 ) {
+                pgmc = v;
+              } else if( s == 4 ) {
+                pamd = v;
               }
-              if( pamatr != 6 ) {
-                pamatr = 0;
+              if( v == 0 || (s == 3 && v > 255)) {
+                pgm = 0;
+              } else {
+                pgmPtr = 0;
               }
             }
-          } else if( c == 0x20 && (pgmw == 0)) {
-            s = 1;
-          } else if( c == 0x0a && (pgmh == 0)) {
-            s = 2;
-          } else if( c == 0x0a && (pgmc == 0) && pgmn != 4 ) {
-            s = 3;
           }
-          if( s != 0 ) {
-            pgmBuf[pgmPtr++] = 0;
-            int v = atoi(pgmBuf); // parse width/height/depth/maxval value
-            if( s == 1 ) {
-              pgmw = v;
-            } else if( s == 2 ) {
-              pgmh = v;
-            } else if( s == 3 ) {
-              pgmc = v;
-            } else if( s == 4 ) {
-              pamd = v;
-            }
-            if( v == 0 || (s == 3 && v > 255)) {
-              pgm = 0;
-            } else {
-              pgmPtr = 0;
-            }
+          if( pgmComment == 0 ) {
+            pgmBuf[pgmPtr++] = c;
+          }
+          if( pgmPtr >= 32 ) {
+            pgm = 0;
+          }
+          if((pgmComment != 0) && c == 0x0a ) {
+            pgmComment = 0;
           }
-        }
-        if( pgmComment == 0 ) {
-          pgmBuf[pgmPtr++] = c;
-        }
-        if( pgmPtr >= 32 ) {
-          pgm = 0;
-        }
-        if((pgmComment != 0) && c == 0x0a ) {
-          pgmComment = 0;
-        }
-        if((pgmw != 0) && (pgmh != 0) && (pgmc == 0) && pgmn == 4 ) {
-          pgmdata = i;
-          pgmDataSize = (pgmw + 7) / 8 * pgmh;
-        }
-        if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 5 || (pgmn == 7 && pamd == 1 && pamatr == 6))) {
-          pgmdata = i;
-          pgmDataSize = pgmw * pgmh;
-        }
-        if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 6 || (pgmn == 7 && pamd == 3 && pamatr == 6))) {
-          pgmdata = i;
-          pgmDataSize = pgmw * 3 * pgmh;
-        }
-        if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 7 && pamd == 4 && pamatr == 6)) {
-          pgmdata = i;
-          pgmDataSize = pgmw * 4 * pgmh;
-        }
-      } else { // pixel data
-        if( textParser->start() == uint32_t(i) || // for any sign of non-text data in pixel area
-            (pgm - 2 == 0 && n - pgmDataSize == i)) // or the image is the whole file/block -> FINISH (success)
-        {
           if((pgmw != 0) && (pgmh != 0) && (pgmc == 0) && pgmn == 4 ) {
-            IMG_DET(IMAGE1, pgm - 2, pgmdata - pgm + 3, (pgmw + 7) / 8, pgmh);
+            pgmdata = i;
+            pgmDataSize = (pgmw + 7) / 8 * pgmh;
           }
           if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 5 || (pgmn == 7 && pamd == 1 && pamatr == 6))) {
-            IMG_DET(IMAGE8GRAY, pgm - 2, pgmdata - pgm + 3, pgmw, pgmh);
+            pgmdata = i;
+            pgmDataSize = pgmw * pgmh;
           }
           if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 6 || (pgmn == 7 && pamd == 3 && pamatr == 6))) {
-            IMG_DET(IMAGE24, pgm - 2, pgmdata - pgm + 3, pgmw * 3, pgmh);
+            pgmdata = i;
+            pgmDataSize = pgmw * 3 * pgmh;
           }
           if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 7 && pamd == 4 && pamatr == 6)) {
-            IMG_DET(IMAGE32, pgm - 2, pgmdata - pgm + 3, pgmw * 4, pgmh);
+            pgmdata = i;
+            pgmDataSize = pgmw * 4 * pgmh;
+          }
+        } else { // pixel data
+          parseText(inBufPos - 1);
+          if( textParser->start() == uint32_t(i) || // for any sign of non-text data in pixel area
+              (pgm - 2 == 0 && n - pgmDataSize == i)) // or the image is the whole file/block -> FINISH (success)
+          {
+            if((pgmw != 0) && (pgmh != 0) && (pgmc == 0) && pgmn == 4 ) {
+              IMG_DET(IMAGE1, pgm - 2, pgmdata - pgm + 3, (pgmw + 7) / 8, pgmh);
+            }
+            if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 5 || (pgmn == 7 && pamd == 1 && pamatr == 6))) {
+              IMG_DET(IMAGE8GRAY, pgm - 2, pgmdata - pgm + 3, pgmw, pgmh);
+            }
+            if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 6 || (pgmn == 7 && pamd == 3 && pamatr == 6))) {
+              IMG_DET(IMAGE24, pgm - 2, pgmdata - pgm + 3, pgmw * 3, pgmh);
+            }
+            if((pgmw != 0) && (pgmh != 0) && (pgmc != 0) && (pgmn == 7 && pamd == 4 && pamatr == 6)) {
+              IMG_DET(IMAGE32, pgm - 2, pgmdata - pgm + 3, pgmw * 4, pgmh);
+            }
+          } else if((--pgmDataSize) == 0 ) {
+            pgm = 0; // all data was probably text in pixel area: fail
           }
-        } else if((--pgmDataSize) == 0 ) {
-          pgm = 0; // all data was probably text in pixel area: fail
         }
       }
-    }
 
-    // Detect .rgb image
-    if((buf0 & 0xffff) == 0x01da ) {
-      rgbi = i, rgbx = rgby = 0;
-    }
-    if( rgbi != 0 ) {
-      const int p = i - rgbi;
-      if( p == 1 && c != 0 ) {
-        rgbi = 0;
-      } else if( p == 2 && c != 1 ) {
-        rgbi = 0;
-      } else if( p == 4 && (buf0 & 0xffff) != 1 && (buf0 & 0xffff) != 2 && (buf0 & 0xffff) != 3 ) {
-        rgbi = 0;
-      } else if( p == 6 ) {
-        rgbx = buf0 & 0xffff, rgbi = (rgbx == 0 ? 0 : rgbi);
-      } else if( p == 8 ) {
-        rgby = buf0 & 0xffff, rgbi = (rgby == 0 ? 0 : rgbi);
-      } else if( p == 10 ) {
-        int z = buf0 & 0xffff;
-        if((rgbx != 0) && (rgby != 0) && (z == 1 || z == 3 || z == 4)) {
-          IMG_DET(IMAGE8, rgbi - 1, 512, rgbx, rgby * z);
-        }
-        rgbi = 0;
+      // Detect .rgb image
+      if((buf0 & 0xffff) == 0x01da ) {
+        rgbi = i, rgbx = rgby = 0;
       }
-    }
-
-    // Detect .tiff file header (2/8/24 bit color, not compressed).
-    if( buf1 == 0x49492a00 && n > i + static_cast<int>(bswap(buf0))) {
-      const uint64_t savedPos = in->curPos();
-      in->setpos(start + i + static_cast<uint64_t>(bswap(buf0)) - 7);
-
-      // read directory
-      int dirSize = in->getchar();
-      int tifX = 0;
-      int tifY = 0;
-      int tifZ = 0;
-      int tifZb = 0;
-      int tifC = 0;
-      int tifofs = 0;
-      int tifofval = 0;
-      int tifSize = 0;
-      int b[12];
-      if( in->getchar() == 0 ) {
-        for( int i = 0; i < dirSize; i++ ) {
-          for( int j = 0; j < 12; j++ ) {
-            b[j] = in->getchar();
-          }
-          if( b[11] == EOF) {
-            break;
-          }
-          int tag = b[0] + (b[1] << 8);
-          int tagFmt = b[2] + (b[3] << 8);
-          int tagLen = b[4] + (b[5] << 8) + (b[6] << 16) + (b[7] << 24);
-          int tagVal = b[8] + (b[9] << 8) + (b[10] << 16) + (b[11] << 24);
-          if( tagFmt == 3 || tagFmt == 4 ) {
-            if( tag == 256 ) {
-              tifX = tagVal;
-            } else if( tag == 257 ) {
-              tifY = tagVal;
-            } else if( tag == 258 ) {
-              tifZb = tagLen == 1 ? tagVal : 8; // bits per component
-            } else if( tag == 259 ) {
-              tifC = tagVal; // 1 = no compression
-            } else if( tag == 273 && tagFmt == 4 ) {
-              tifofs = tagVal, tifofval = static_cast<int>(tagLen <= 1);
-            } else if( tag == 277 ) {
-              tifZ = tagVal; // components per pixel
-            } else if( tag == 279 && tagLen == 1 ) {
-              tifSize = tagVal;
-            }
+      if( rgbi != 0 ) {
+        const int p = i - rgbi;
+        if( p == 1 && c != 0 ) {
+          rgbi = 0;
+        } else if( p == 2 && c != 1 ) {
+          rgbi = 0;
+        } else if( p == 4 && (buf0 & 0xffff) != 1 && (buf0 & 0xffff) != 2 && (buf0 & 0xffff) != 3 ) {
+          rgbi = 0;
+        } else if( p == 6 ) {
+          rgbx = buf0 & 0xffff, rgbi = (rgbx == 0 ? 0 : rgbi);
+        } else if( p == 8 ) {
+          rgby = buf0 & 0xffff, rgbi = (rgby == 0 ? 0 : rgbi);
+        } else if( p == 10 ) {
+          int z = buf0 & 0xffff;
+          if((rgbx != 0) && (rgby != 0) && (z == 1 || z == 3 || z == 4)) {
+            IMG_DET(IMAGE8, rgbi - 1, 512, rgbx, rgby * z);
           }
+          rgbi = 0;
         }
       }
-      if((tifX != 0) && (tifY != 0) && (tifZb != 0) && (tifZ == 1 || tifZ == 3) && ((tifC == 1) || (tifC == 5 /*LZW*/ && tifSize > 0)) &&
-         ((tifofs != 0) && tifofs + i < n)) {
-        if( tifofval == 0 ) {
-          in->setpos(start + i + tifofs - 7);
-          for( int j = 0; j < 4; j++ ) {
-            b[j] = in->getchar();
+
+      // Detect .tiff file header (2/8/24 bit color, not compressed).
+      if( buf1 == 0x49492a00 && n > i + static_cast<int>(bswap(buf0))) {
+        const uint64_t savedPos = in->curPos();
+        in->setpos(start + i + static_cast<uint64_t>(bswap(buf0)) - 7);
+
+        // read directory
+        int dirSize = in->getchar();
+        int tifX = 0;
+        int tifY = 0;
+        int tifZ = 0;
+        int tifZb = 0;
+        int tifC = 0;
+        int tifofs = 0;
+        int tifofval = 0;
+        int tifSize = 0;
+        int b[12];
+        if( in->getchar() == 0 ) {
+          for( int i = 0; i < dirSize; i++ ) {
+            for( int j = 0; j < 12; j++ ) {
+              b[j] = in->getchar();
+            }
+            if( b[11] == EOF) {
+              break;
+            }
+            int tag = b[0] + (b[1] << 8);
+            int tagFmt = b[2] + (b[3] << 8);
+            int tagLen = b[4] + (b[5] << 8) + (b[6] << 16) + (b[7] << 24);
+            int tagVal = b[8] + (b[9] << 8) + (b[10] << 16) + (b[11] << 24);
+            if( tagFmt == 3 || tagFmt == 4 ) {
+              if( tag == 256 ) {
+                tifX = tagVal;
+              } else if( tag == 257 ) {
+                tifY = tagVal;
+              } else if( tag == 258 ) {
+                tifZb = tagLen == 1 ? tagVal : 8; // bits per component
+              } else if( tag == 259 ) {
+                tifC = tagVal; // 1 = no compression
+              } else if( tag == 273 && tagFmt == 4 ) {
+                tifofs = tagVal, tifofval = static_cast<int>(tagLen <= 1);
+              } else if( tag == 277 ) {
+                tifZ = tagVal; // components per pixel
+              } else if( tag == 279 && tagLen == 1 ) {
+                tifSize = tagVal;
+              }
+            }
           }
-          tifofs = b[0] + (b[1] << 8) + (b[2] << 16) + (b[3] << 24);
         }
-        if((tifofs != 0) && tifofs < (1 << 18) && tifofs + i < n ) {
-          if( tifC == 1 ) {
-            if( tifZ == 1 && tifZb == 1 ) {
-              IMG_DET(IMAGE1, i - 7, tifofs, ((tifX - 1) >> 3) + 1, tifY);
-            }
-            if( tifZ == 1 && tifZb == 8 ) {
-              IMG_DET(IMAGE8, i - 7, tifofs, tifX, tifY);
+        if((tifX != 0) && (tifY != 0) && (tifZb != 0) && (tifZ == 1 || tifZ == 3) && ((tifC == 1) || (tifC == 5 /*LZW*/ && tifSize > 0)) &&
+           ((tifofs != 0) && tifofs + i < n)) {
+          if( tifofval == 0 ) {
+            in->setpos(start + i + tifofs - 7);
+            for( int j = 0; j < 4; j++ ) {
+              b[j] = in->getchar();
             }
-            if( tifZ == 3 && tifZb == 8 ) {
-              IMG_DET(IMAGE24, i - 7, tifofs, tifX * 3, tifY);
+            tifofs = b[0] + (b[1] << 8) + (b[2] << 16) + (b[3] << 24);
+          }
+          if((tifofs != 0) && tifofs < (1 << 18) && tifofs + i < n ) {
+            if( tifC == 1 ) {
+              if( tifZ == 1 && tifZb == 1 ) {
+                IMG_DET(IMAGE1, i - 7, tifofs, ((tifX - 1) >> 3) + 1, tifY);
+              }
+              if( tifZ == 1 && tifZb == 8 ) {
+                IMG_DET(IMAGE8, i - 7, tifofs, tifX, tifY);
+              }
+              if( tifZ == 3 && tifZb == 8 ) {
+                IMG_DET(IMAGE24, i - 7, tifofs, tifX * 3, tifY);
+              }
+            } else if( tifC == 5 && tifSize > 0 ) {
+              tifX = ((tifX + 8 - tifZb) / (9 - tifZb)) * tifZ;
+              info = tifZ * tifZb;
+              info = (((info == 1) ? IMAGE1 : ((info == 8) ? IMAGE8 : IMAGE24)) << 24) | tifX;
+              detd = tifSize;
+              in->setpos(start + i - 7 + tifofs);
+              return dett = LZW;
             }
-          } else if( tifC == 5 && tifSize > 0 ) {
-            tifX = ((tifX + 8 - tifZb) / (9 - tifZb)) * tifZ;
-            info = tifZ * tifZb;
-            info = (((info == 1) ? IMAGE1 : ((info == 8) ? IMAGE8 : IMAGE24)) << 24) | tifX;
-            detd = tifSize;
-            in->setpos(start + i - 7 + tifofs);
-            return dett = LZW;
           }
         }
+        in->setpos(savedPos);
       }
-      in->setpos(savedPos);
-    }
 
-    // Detect .tga image (8-bit 256 colors or 24-bit uncompressed)
-    if((buf1 & 0xFFF7FF) == 0x00010100 && (buf0 & 0xFFFFFFC7) == 0x00000100 && (c == 16 || c == 24 || c == 32)) {
-      tga = i, tgax = tgay, tgaz = 8, tgat = (buf1 >> 8) & 0xF, tgaid = buf1 >> 24, tgamap = c / 8;
-    } else if((buf1 & 0xFFFFFF) == 0x00000200 && buf0 == 0x00000000 ) {
-      tga = i, tgax = tgay, tgaz = 24, tgat = 2;
-    } else if((buf1 & 0xFFF7FF) == 0x00000300 && buf0 == 0x00000000 ) {
-      tga = i, tgax = tgay, tgaz = 8, tgat = (buf1 >> 8) & 0xF;
-    }
-    if( tga != 0 ) {
-      if( i - tga == 8 ) {
-        tga = (buf1 == 0 ? tga : 0), tgax = (bswap(buf0) & 0xffff), tgay = (bswap(buf0) >> 16);
-      } else if( i - tga == 10 ) {
-        if((buf0 & 0xFFF7) == 32 << 8 ) {
-          tgaz = 32;
-        }
-        if((tgaz << 8) == static_cast<int>(buf0 & 0xFFD7) && (tgax != 0) && (tgay != 0) && uint32_t(tgax * tgay) < 0xFFFFFFF ) {
-          if( tgat == 1 ) {
-            in->setpos(start + tga + 11 + tgaid);
-            IMG_DET((isGrayscalePalette(in)) ? IMAGE8GRAY : IMAGE8, tga - 7, 18 + tgaid + 256 * tgamap, tgax, tgay);
-          }
-          if( tgat == 2 ) {
-            IMG_DET((tgaz == 24) ? IMAGE24 : IMAGE32, tga - 7, 18 + tgaid, tgax * (tgaz >> 3), tgay);
-          }
-          if( tgat == 3 ) {
-            IMG_DET(IMAGE8GRAY, tga - 7, 18 + tgaid, tgax, tgay);
+      // Detect .tga image (8-bit 256 colors or 24-bit uncompressed)
+      if((buf1 & 0xFFF7FF) == 0x00010100 && (buf0 & 0xFFFFFFC7) == 0x00000100 && (c == 16 || c == 24 || c == 32)) {
+        tga = i, tgax = tgay, tgaz = 8, tgat = (buf1 >> 8) & 0xF, tgaid = buf1 >> 24, tgamap = c / 8;
+      } else if((buf1 & 0xFFFFFF) == 0x00000200 && buf0 == 0x00000000 ) {
+        tga = i, tgax = tgay, tgaz = 24, tgat = 2;
+      } else if((buf1 & 0xFFF7FF) == 0x00000300 && buf0 == 0x00000000 ) {
+        tga = i, tgax = tgay, tgaz = 8, tgat = (buf1 >> 8) & 0xF;
+      }
+      if( tga != 0 ) {
+        if( i - tga == 8 ) {
+          tga = (buf1 == 0 ? tga : 0), tgax = (bswap(buf0) & 0xffff), tgay = (bswap(buf0) >> 16);
+        } else if( i - tga == 10 ) {
+          if((buf0 & 0xFFF7) == 32 << 8 ) {
+            tgaz = 32;
           }
-          if( tgat == 9 || tgat == 11 ) {
-            const uint64_t savedPos = in->curPos();
-            in->setpos(start + tga + 11 + tgaid);
-            if( tgat == 9 ) {
-              info = (isGrayscalePalette(in) ? IMAGE8GRAY : IMAGE8) << 24;
-              in->setpos(start + tga + 11 + tgaid + 256 * tgamap);
-            } else {
-              info = IMAGE8GRAY << 24;
+          if((tgaz << 8) == static_cast<int>(buf0 & 0xFFD7) && (tgax != 0) && (tgay != 0) && uint32_t(tgax * tgay) < 0xFFFFFFF ) {
+            if( tgat == 1 ) {
+              in->setpos(start + tga + 11 + tgaid);
+              IMG_DET((isGrayscalePalette(in)) ? IMAGE8GRAY : IMAGE8, tga - 7, 18 + tgaid + 256 * tgamap, tgax, tgay);
             }
-            info |= tgax;
-            // now detect compressed image data size
-            detd = 0;
-            int c = in->getchar();
-            int b = 0;
-            int total = tgax * tgay;
-            int line = 0;
-            while( total > 0 && c >= 0 && (++detd, b = in->getchar()) >= 0 ) {
-              if( c == 0x80 ) {
-                c = b;
-                continue;
-              }
-              if( c > 0x7F ) {
-                total -= (c = (c & 0x7F) + 1);
-                line += c;
-                c = in->getchar();
-                detd++;
+            if( tgat == 2 ) {
+              IMG_DET((tgaz == 24) ? IMAGE24 : IMAGE32, tga - 7, 18 + tgaid, tgax * (tgaz >> 3), tgay);
+            }
+            if( tgat == 3 ) {
+              IMG_DET(IMAGE8GRAY, tga - 7, 18 + tgaid, tgax, tgay);
+            }
+            if( tgat == 9 || tgat == 11 ) {
+              const uint64_t savedPos = in->curPos();
+              in->setpos(start + tga + 11 + tgaid);
+              if( tgat == 9 ) {
+                info = (isGrayscalePalette(in) ? IMAGE8GRAY : IMAGE8) << 24;
+                in->setpos(start + tga + 11 + tgaid + 256 * tgamap);
               } else {
-                in->setpos(in->curPos() + c);
-                detd += ++c;
-                total -= c;
-                line += c;
-                c = in->getchar();
+                info = IMAGE8GRAY << 24;
               }
-              if( line > tgax ) {
-                break;
+              info |= tgax;
+              // now detect compressed image data size
+              detd = 0;
+              int c = in->getchar();
+              int b = 0;
+              int total = tgax * tgay;
+              int line = 0;
+              while( total > 0 && c >= 0 && (++detd, b = in->getchar()) >= 0 ) {
+                if( c == 0x80 ) {
+                  c = b;
+                  continue;
+                }
+                if( c > 0x7F ) {
+                  total -= (c = (c & 0x7F) + 1);
+                  line += c;
+                  c = in->getchar();
+                  detd++;
+                } else {
+                  in->setpos(in->curPos() + c);
+                  detd += ++c;
+                  total -= c;
+                  line += c;
+                  c = in->getchar();
+                }
+                if( line > tgax ) {
+                  break;
+                }
+                if( line == tgax ) {
+                  line = 0;
+                }
               }
-              if( line == tgax ) {
-                line = 0;
+              if( total == 0 ) {
+                in->setpos(start + tga + 11 + tgaid + 256 * tgamap);
+                return dett = RLE;
               }
+              in->setpos(savedPos);
             }
-            if( total == 0 ) {
-              in->setpos(start + tga + 11 + tgaid + 256 * tgamap);
-              return dett = RLE;
-            }
-            in->setpos(savedPos);
           }
+          tga = 0;
         }
-        tga = 0;
       }
-    }
 
-    // Detect .gif
-    if( type == DEFAULT && dett == GIF && i == 0 ) {
-      dett = DEFAULT;
-      if( c == 0x2c || c == 0x21 ) {
-        gif = 2, gifi = 2;
-      } else {
-        gifGray = 0;
-      }
-    }
-    if((gif == 0) && (buf1 & 0xffff) == 0x4749 && (buf0 == 0x46383961 || buf0 == 0x46383761)) {
-      gif = 1, gifi = i + 5;
-    }
-    if( gif != 0 ) {
-      if( gif == 1 && i == gifi ) {
-        gif = 2, gifi = i + 5 + (gifplt = (c & 128) != 0 ? (3 * (2 << (c & 7))) : 0);
-      }
-      if( gif == 2 && (gifplt != 0) && i == gifi - gifplt - 3 ) {
-        gifGray = static_cast<int>(isGrayscalePalette(in, gifplt / 3)), gifplt = 0;
-      }
-      if( gif == 2 && i == gifi ) {
-        if((buf0 & 0xff0000) == 0x210000 ) {
-          gif = 5, gifi = i;
-        } else if((buf0 & 0xff0000) == 0x2c0000 ) {
-          gif = 3, gifi = i;
+      // Detect .gif
+      if( type == DEFAULT && dett == GIF && i == 0 ) {
+        dett = DEFAULT;
+        if( c == 0x2c || c == 0x21 ) {
+          gif = 2, gifi = 2;
         } else {
-          gif = 0;
+          gifGray = 0;
         }
       }
-      if( gif == 3 && i == gifi + 6 ) {
-        gifw = (bswap(buf0) & 0xffff);
-      }
-      if( gif == 3 && i == gifi + 7 ) {
-        gif = 4, gifc = gifb = 0, gifa = gifi = i + 2 + (gifplt = ((c & 128) != 0 ? (3 * (2 << (c & 7))) : 0));
+      if((gif == 0) && (buf1 & 0xffff) == 0x4749 && (buf0 == 0x46383961 || buf0 == 0x46383761)) {
+        gif = 1, gifi = i + 5;
       }
-      if( gif == 4 && (gifplt != 0)) {
-        gifGray = static_cast<int>(isGrayscalePalette(in, gifplt / 3)), gifplt = 0;
-      }
-      if( gif == 4 && i == gifi ) {
-        if( c > 0 && (gifb != 0) && gifc != gifb ) {
-          gifw = 0;
+      if( gif != 0 ) {
+        if( gif == 1 && i == gifi ) {
+          gif = 2, gifi = i + 5 + (gifplt = (c & 128) != 0 ? (3 * (2 << (c & 7))) : 0);
         }
-        if( c > 0 ) {
-          gifb = gifc, gifc = c, gifi += c + 1;
-        } else if( gifw == 0 ) {
-          gif = 2, gifi = i + 3;
-        } else {
-          return in->setpos(start + gifa - 1), detd = i - gifa + 2, info = ((gifGray != 0 ? IMAGE8GRAY : IMAGE8) << 24) | gifw, dett = GIF;
+        if( gif == 2 && (gifplt != 0) && i == gifi - gifplt - 3 ) {
+          gifGray = static_cast<int>(isGrayscalePaletteAhead(gifplt / 3)), gifplt = 0;
         }
-      }
-      if( gif == 5 && i == gifi ) {
-        if( c > 0 ) {
-          gifi += c + 1;
-        } else {
-          gif = 2, gifi = i + 3;
+        if( gif == 2 && i == gifi ) {
+          if((buf0 & 0xff0000) == 0x210000 ) {
+            gif = 5, gifi = i;
+          } else if((buf0 & 0xff0000) == 0x2c0000 ) {
+            gif = 3, gifi = i;
+          } else {
+            gif = 0;
+          }
+        }
+        if( gif == 3 && i == gifi + 6 ) {
+          gifw = (bswap(buf0) & 0xffff);
+        }
+        if( gif == 3 && i == gifi + 7 ) {
+          gif = 4, gifc = gifb = 0, gifa = gifi = i + 2 + (gifplt = ((c & 128) != 0 ? (3 * (2 << (c & 7))) : 0));
+        }
+        if( gif == 4 && (gifplt != 0)) {
+          gifGray = static_cast<int>(isGrayscalePaletteAhead(gifplt / 3)), gifplt = 0;
+        }
+        if( gif == 4 && i == gifi ) {
+          if( c > 0 && (gifb != 0) && gifc != gifb ) {
+            gifw = 0;
+          }
+          if( c > 0 ) {
+            gifb = gifc, gifc = c, gifi += c + 1;
+          } else if( gifw == 0 ) {
+            gif = 2, gifi = i + 3;
+          } else {
+            return in->setpos(start + gifa - 1), detd = i - gifa + 2, info = ((gifGray != 0 ? IMAGE8GRAY : IMAGE8) << 24) | gifw, dett = GIF;
+          }
+        }
+        if( gif == 5 && i == gifi ) {
+          if( c > 0 ) {
+            gifi += c + 1;
+          } else {
+            gif = 2, gifi = i + 3;
+          }
         }
       }
     }
@@ -1132,8 +1215,7 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
       relPos[r] = i;
     }
     if( i - e8e9last > 0x4000 ) {
-      // TODO: Large file support
-      if( type == EXE ) {
+      if( type == EXE ) { // info: the base of the absolute addresses (modulo 2^32)
         info = static_cast<int>(start);
         in->setpos(start + e8e9last);
         return DEFAULT;
@@ -1141,83 +1223,56 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
       e8e9count = e8e9pos = 0;
     }
 
-    // Detect base64 encoded data
-    if( b64S == 0 && buf0 == 0x73653634 && ((buf1 & 0xffffff) == 0x206261 || (buf1 & 0xffffff) == 0x204261)) {
-      b64S = 1; b64I = i - 6; //' base64' ' Base64'
-    }
-    if( b64S == 0 && ((buf1 == 0x3b626173 && buf0 == 0x6536342c) || (buf1 == 0x215b4344 && buf0 == 0x4154415b))) {
-      b64S = 3; b64I = i + 1; // ';base64,' '![CDATA['
-    }
-    if( b64S > 0 ) {
-      if( b64S == 1 && buf0 == 0x0d0a0d0a ) {
-        b64I = i + 1; b64Line = 0; b64S = 2;
-      } else if( b64S == 2 && (buf0 & 0xffff) == 0x0d0a && b64Line == 0 ) {
-        b64Line = i + 1 - b64I; b64Nl = i;
-      } else if( b64S == 2 && (buf0 & 0xffff) == 0x0d0a && b64Line > 0 && (buf0 & 0xffffff) != 0x3d0d0a ) {
-        if( i - b64Nl < b64Line && buf0 != 0x0d0a0d0a ) {
-          i -= 1; b64S = 5;
-        } else if( buf0 == 0x0d0a0d0a ) {
-          i -= 3; b64S = 5;
-        } else if( i - b64Nl == b64Line ) {
-          b64Nl = i;
-        } else {
-          b64S = 0;
-        }
-      } else if( b64S == 2 && (buf0 & 0xffffff) == 0x3d0d0a ) {
-        i -= 1; b64S = 5; // '=' or '=='
-      } else if( b64S == 2 && !(isalnum(c) || c == '+' || c == '/' || c == 10 || c == 13 || c == '=')) {
-        b64S = 0;
-      }
-      if( b64Line > 0 && (b64Line <= 4 || b64Line > 255)) {
-        b64S = 0;
+    if( !idle ) {
+      // Detect base64 encoded data
+      if( b64S == 0 && buf0 == 0x73653634 && ((buf1 & 0xffffff) == 0x206261 || (buf1 & 0xffffff) == 0x204261)) {
+        b64S = 1; b64I = i - 6; //' base64' ' Base64'
       }
-      if( b64S == 3 && i >= b64I && !(isalnum(c) || c == '+' || c == '/' || c == '=')) {
-        b64S = 4;
+      if( b64S == 0 && ((buf1 == 0x3b626173 && buf0 == 0x6536342c) || (buf1 == 0x215b4344 && buf0 == 0x4154415b))) {
+        b64S = 3; b64I = i + 1; // ';base64,' '![CDATA['
       }
-      if((b64S == 4 && i - b64I > 128) || (b64S == 5 && i - b64I > 512 && i - b64I < (1 << 27))) {
-        in->setpos(start + b64I);
-        detd = i - b64I;
-        return BASE64;
-      }
-      if( b64S > 3 ) {
-        b64S = 0;
-      }
-      if( b64S == 1 && i - b64I >= 128 ) {
-        b64S = 0; // detect false positives after 128 bytes
-      }
-    }
-
-
-    // Detect text
-    // This is different from the above detection routines: it's a negative detection (it detects a failure)
-    uint32_t t = TextParserStateInfo::utf8StateTable[c];
-    textParser->UTF8State = TextParserStateInfo::utf8StateTable[256 + textParser->UTF8State + t];
-    if( textParser->UTF8State == TextParserStateInfo::utf8Accept ) { // proper end of a valid utf8 sequence
-      if( c == NEW_LINE ) {
-        if(((buf0 >> 8) & 0xff) != CARRIAGE_RETURN ) {
-          textParser->setEolType(2); // mixed or LF-only
-        } else if( textParser->eolType() == 0 ) {
-          textParser->setEolType(1); // CRLF-only
+      if( b64S > 0 ) {
+        if( b64S == 1 && buf0 == 0x0d0a0d0a ) {
+          b64I = i + 1; b64Line = 0; b64S = 2;
+        } else if( b64S == 2 && (buf0 & 0xffff) == 0x0d0a && b64Line == 0 ) {
+          b64Line = i + 1 - b64I; b64Nl = i;
+        } else if( b64S == 2 && (buf0 & 0xffff) == 0x0d0a && b64Line > 0 && (buf0 & 0xffffff) != 0x3d0d0a ) {
+          if( i - b64Nl < b64Line && buf0 != 0x0d0a0d0a ) {
+            i -= 1; b64S = 5;
+          } else if( buf0 == 0x0d0a0d0a ) {
+            i -= 3; b64S = 5;
+          } else if( i - b64Nl == b64Line ) {
+            b64Nl = i;
+          } else {
+            b64S = 0;
+          }
+        } else if( b64S == 2 && (buf0 & 0xffffff) == 0x3d0d0a ) {
+          i -= 1; b64S = 5; // '=' or '=='
+        } else if( b64S == 2 && !(isalnum(c) || c == '+' || c == '/' || c == 10 || c == 13 || c == '=')) {
+          b64S = 0;
         }
-      }
-      textParser->invalidCount = textParser->invalidCount * (TEXT_ADAPT_RATE - 1) / TEXT_ADAPT_RATE;
-      if( textParser->invalidCount == 0 ) {
-        textParser->setEnd(i); // a possible end of block position
-      }
-    } else if( textParser->UTF8State == TextParserStateInfo::utf8Reject ) { // illegal state
-      textParser->invalidCount = textParser->invalidCount * (TEXT_ADAPT_RATE - 1) / TEXT_ADAPT_RATE + TEXT_ADAPT_RATE;
-      textParser->UTF8State = TextParserStateInfo::utf8Accept; // reset state
-      if( textParser->validLength() < TEXT_MIN_SIZE ) {
-        textParser->reset(i + 1); // it's not text (or not long enough) - start over
-      } else if( textParser->invalidCount >= TEXT_MAX_MISSES * TEXT_ADAPT_RATE ) {
-        if( textParser->validLength() < TEXT_MIN_SIZE ) {
-          textParser->reset(i + 1); // it's not text (or not long enough) - start over
-        } else { // Commit text block validation
-          textParser->next(i + 1);
+        if( b64Line > 0 && (b64Line <= 4 || b64Line > 255)) {
+          b64S = 0;
+        }
+        if( b64S == 3 && i >= b64I && !(isalnum(c) || c == '+' || c == '/' || c == '=')) {
+          b64S = 4;
+        }
+        if((b64S == 4 && i - b64I > 128) || (b64S == 5 && i - b64I > 512 && i - b64I < (1 << 27))) {
+          in->setpos(start + b64I);
+          detd = i - b64I;
+          return BASE64;
+        }
+        if( b64S > 3 ) {
+          b64S = 0;
+        }
+        if( b64S == 1 && i - b64I >= 128 ) {
+          b64S = 0; // detect false positives after 128 bytes
         }
       }
     }
   }
+  parseText(inBufPos);
+  in->setpos(start + inPos);
   return type;
 }
 
@@ -1231,7 +1286,12 @@ static auto detect(File *in, uint64_t blockSize, BlockType type, int &info) -> B
 //////////////////// Compress, Decompress ////////////////////////////
 
 static void directEncodeBlock(BlockType type, File *in, uint64_t len, Encoder &en, int info = -1) {
-  // TODO: Large file support
+  if( Shared::getInstance()->modelSelection ) {
+    const uint32_t mask = selectModels(in, len, type);
+    if( mask != 0 ) {
+      en.encodeModelMask(mask);
+    }
+  }
   en.compress(type);
   en.encodeBlockSize(len);
   if( info != -1 ) {
@@ -1277,7 +1337,7 @@ decodeFunc(BlockType type, Encoder &en, File *tmp, uint64_t len, int info, File
     return d->decode(tmp, out, mode, len, diffFound);
   } else if( type == CD ) {
     auto c = new CdFilter();
-    c->decode(tmp, out, mode, len, diffFound);
+    return c->decode(tmp, out, mode, len, diffFound);
   }
 #ifndef DISABLE_ZLIB
   else if( type == ZLIB )
@@ -1293,6 +1353,9 @@ decodeFunc(BlockType type, Encoder &en, File *tmp, uint64_t len, int info, File
     return r->decode(tmp, out, mode, len, diffFound);
   } else if( type == LZW ) {
     return decodeLzw(tmp, out, mode, diffFound);
+  } else if( type == LZ77 ) {
+    auto l = new Lz77Filter();
+    return l->decode(tmp, out, mode, len, diffFound);
   } else {
     assert(false);
   }
@@ -1332,6 +1395,9 @@ static auto encodeFunc(BlockType type, File *in, File *tmp, uint64_t len, int in
     r->encode(in, tmp, len, info, hdrsize);
   } else if( type == LZW ) {
     return encodeLzw(in, tmp, len, hdrsize) != 0 ? 0 : 1;
+  } else if( type == LZ77 ) {
+    auto l = new Lz77Filter();
+    l->encode(in, tmp, len, info, hdrsize);
   } else {
     assert(false);
   }
@@ -1347,7 +1413,15 @@ transformEncodeBlock(BlockType type, File *in, uint64_t len, Encoder &en, int in
     uint64_t diffFound = encodeFunc(type, in, &tmp, len, info, headerSize);
     const uint64_t tmpSize = tmp.curPos();
     tmp.setpos(tmpSize); //switch to read mode
-    if( diffFound == 0 ) {
+    if( type == LZ77 && headerSize == 1 ) { // no long-range matches were found: keep the original content
+      tmp.close();
+      in->setpos(begin);
+      compressRecursive(in, len, en, blstr, recursionLevel, p1, p2);
+      return;
+    }
+    if( diffFound == 0 && type == ZLIB && Shared::getInstance()->fastVerify ) {
+      in->setpos(begin + len); // checked by encodeZlib() already
+    } else if( diffFound == 0 ) {
       tmp.setpos(0);
       en.setFile(&tmp);
       in->setpos(begin);
@@ -1361,7 +1435,6 @@ transformEncodeBlock(BlockType type, File *in, uint64_t len, Encoder &en, int in
     } else {
       tmp.setpos(0);
       if( hasRecursion(type)) {
-        // TODO(epsteina): Large file support
         en.compress(type);
         en.encodeBlockSize(tmpSize);
         BlockType type2 = static_cast<BlockType>((info >> 24) & 0xFF);
@@ -1375,11 +1448,11 @@ transformEncodeBlock(BlockType type, File *in, uint64_t len, Encoder &en, int in
           String blstrSub2;
           blstrSub2 += blstr.c_str();
           blstrSub2 += "-->";
-          printf(" %-11s | ->  exploded     |%10d bytes [%d - %d]\n", blstrSub0.c_str(), int(tmpSize), 0, int(tmpSize - 1));
+          printf(" %-11s | ->  exploded     |%10" PRIu64 " bytes [0 - %" PRIu64 "]\n", blstrSub0.c_str(), tmpSize, tmpSize - 1);
           printf(" %-11s | --> added header |%10d bytes [%d - %d]\n", blstrSub1.c_str(), headerSize, 0, headerSize - 1);
           directEncodeBlock(HDR, &tmp, headerSize, en);
-          printf(" %-11s | --> data         |%10d bytes [%d - %d]\n", blstrSub2.c_str(), int(tmpSize - headerSize), headerSize,
-                 int(tmpSize - 1));
+          printf(" %-11s | --> data         |%10" PRIu64 " bytes [%d - %" PRIu64 "]\n", blstrSub2.c_str(), tmpSize - headerSize, headerSize,
+                 tmpSize - 1);
           transformEncodeBlock(type2, &tmp, tmpSize - headerSize, en, info & 0xffffff, blstr, recursionLevel, p1, p2, headerSize);
         } else {
           compressRecursive(&tmp, tmpSize, en, blstr, recursionLevel + 1, p1, p2);
@@ -1395,9 +1468,10 @@ transformEncodeBlock(BlockType type, File *in, uint64_t len, Encoder &en, int in
 }
 
 static void compressRecursive(File *in, const uint64_t blockSize, Encoder &en, String &blstr, int recursionLevel, float p1, float p2) {
-  static const char *typeNames[25] = {"default", "filecontainer", "jpeg", "hdr", "1b-image", "4b-image", "8b-image", "8b-img-grayscale",
+  static const char *typeNames[28] = {"default", "filecontainer", "jpeg", "hdr", "1b-image", "4b-image", "8b-image", "8b-img-grayscale",
                                       "24b-image", "32b-image", "audio", "audio - le", "exe", "cd", "zlib", "base64", "gif", "png-8b",
-                                      "png-8b-grayscale", "png-24b", "png-32b", "text", "text - eol", "rle", "lzw"};
+                                      "png-8b-grayscale", "png-24b", "png-32b", "text", "text - eol", "rle", "lzw", "dedup", "lz77",
+                                      "stream"};
   static const char *audioTypes[4] = {"8b-mono", "8b-stereo", "16b-mono", "16b-stereo"};
   BlockType type = DEFAULT;
   int blNum = 0;
@@ -1492,6 +1566,61 @@ static void compressRecursive(File *in, const uint64_t blockSize, Encoder &en, S
   }
 }
 
+// Compress a top level block (a whole file or the non-duplicate parts of it).
+// With the long-range match transform enabled, the block is first encoded as a single LZ77 block.
+static void compressTopLevel(File *in, uint64_t blockSize, Encoder &en, String &blstr, float p1, float p2) {
+  Shared *shared = Shared::getInstance();
+  if((shared->options & OPTION_LZ77) != 0U && blockSize >= Lz77Filter::MIN_MATCH * 2 ) {
+    const uint64_t begin = in->curPos();
+    String blstrSub;
+    blstrSub += blstr.c_str();
+    if( blstrSub.strsize() != 0 ) {
+      blstrSub += "-";
+    }
+    blstrSub += uint64_t(0);
+    printf(" %-11s | %-16s |%10" PRIu64 " bytes [%" PRIu64 " - %" PRIu64 "]\n", blstrSub.c_str(), "lz77", blockSize, begin,
+           begin + blockSize - 1);
+    en.setStatusRange(p1, p2);
+    transformEncodeBlock(LZ77, in, blockSize, en, 0, blstrSub, 0, p1, p2, begin);
+  } else {
+    compressRecursive(in, blockSize, en, blstr, 0, p1, p2);
+  }
+}
+
+// Compress a file with deduplication. Repeated content-defined chunks (of this or of any previous file in the archive)
+// are replaced by DEDUP blocks:
+// <DEDUP> <size> <length> <source file index> <source offset>
+// where size is the number of bytes of the 3 VLI-encoded values following it. The rest is compressed as usual.
+static void compressDeduplicated(File *in, uint64_t fileSize, Encoder &en) {
+  Deduplicator *dedup = Deduplicator::getInstance();
+  Array<Deduplicator::Segment> segments(0);
+  dedup->analyze(in, fileSize, segments);
+  const uint64_t start = in->curPos();
+  const float pscale = fileSize > 0 ? 1.0F / fileSize : 0;
+  for( uint64_t i = 0; i < segments.size(); i++ ) {
+    const Deduplicator::Segment &segment = segments[i];
+    const float p1 = pscale * segment.begin;
+    const float p2 = pscale * (segment.begin + segment.length);
+    String blstr;
+    if( segments.size() > 1 ) {
+      blstr += i;
+    }
+    if( segment.isReference ) {
+      printf(" %-11s | %-16s |%10" PRIu64 " bytes [%" PRIu64 " - %" PRIu64 "] (file: %d, offset: %" PRIu64 ")\n", blstr.c_str(), "dedup",
+             segment.length, segment.begin, segment.begin + segment.length - 1, segment.srcFile + 1, segment.srcOffset);
+      en.setStatusRange(p1, p2);
+      en.compress(DEDUP);
+      en.encodeBlockSize(VLICost(segment.length) + VLICost(segment.srcFile) + VLICost(segment.srcOffset));
+      en.encodeBlockSize(segment.length);
+      en.encodeBlockSize(segment.srcFile);
+      en.encodeBlockSize(segment.srcOffset);
+    } else {
+      in->setpos(start + segment.begin);
+      compressTopLevel(in, segment.length, en, blstr, p1, p2);
+    }
+  }
+}
+
 // Compress a file. Split fileSize bytes into blocks by type.
 // For each block, output
 // <type> <size> and call encode_X to convert to type X.
@@ -1505,11 +1634,16 @@ static void compressfile(const char *filename, uint64_t fileSize, Encoder &en, b
   uint64_t start = en.size();
   en.encodeBlockSize(fileSize);
 
-  FileDisk in;
+  FileMapped in;
   in.open(filename, true);
+  Deduplicator::getInstance()->addFile(filename);
   printf("Block segmentation:\n");
-  String blstr;
-  compressRecursive(&in, fileSize, en, blstr, 0, 0.0F, 1.0F);
+  if((shared->options & OPTION_DEDUP) != 0U ) {
+    compressDeduplicated(&in, fileSize, en);
+  } else {
+    String blstr;
+    compressTopLevel(&in, fileSize, en, blstr, 0.0F, 1.0F);
+  }
   in.close();
 
   if((shared->options & OPTION_MULTIPLE_FILE_MODE) != 0u ) { //multiple file mode
@@ -1521,6 +1655,46 @@ static void compressfile(const char *filename, uint64_t fileSize, Encoder &en, b
   }
 }
 
+// Compress a stream of unknown length (e.g. the standard input).
+// The stream is processed in windows of at most STREAM_WINDOW_SIZE bytes. A window is buffered in a temporary file,
+// so that block detection and the transforms can look ahead and rewind as usual. For each window, output
+// <STREAM> <size> <blocks of the window>
+// The end of the stream is marked by a window of size 0.
+static constexpr uint64_t STREAM_WINDOW_SIZE = 64 * 1024 * 1024;
+
+static auto compressStream(File *in, Encoder &en) -> uint64_t {
+  assert(en.getMode() == COMPRESS);
+  Array<uint8_t> buf(1U << 16U);
+  uint64_t streamSize = 0;
+  printf("Block segmentation:\n");
+  for( uint64_t window = 0;; window++ ) {
+    FileTmp tmp;
+    uint64_t windowSize = 0;
+    while( windowSize < STREAM_WINDOW_SIZE ) {
+      const uint64_t n = in->blockRead(&buf[0], min(static_cast<uint64_t>(buf.size()), STREAM_WINDOW_SIZE - windowSize));
+      if( n == 0 ) {
+        break;
+      }
+      tmp.blockWrite(&buf[0], n);
+      windowSize += n;
+    }
+    en.compress(STREAM);
+    en.encodeBlockSize(windowSize);
+    if( windowSize == 0 ) {
+      break;
+    }
+    printf(" %-11" PRIu64 " | %-16s |%10" PRIu64 " bytes [%" PRIu64 " - %" PRIu64 "]\n", window, "stream", windowSize, streamSize,
+           streamSize + windowSize - 1);
+    String blstr;
+    blstr += window;
+    tmp.setpos(0);
+    compressTopLevel(&tmp, windowSize, en, blstr, 0.0F, 1.0F);
+    tmp.close();
+    streamSize += windowSize;
+  }
+  return streamSize;
+}
+
 static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMode mode, int recursionLevel) -> uint64_t {
   BlockType type;
   uint64_t len = 0;
@@ -1537,7 +1711,15 @@ static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMod
         info += en.decompress();
       }
     }
-    if( hasRecursion(type)) {
+    if( type == DEDUP ) {
+      len = en.decodeBlockSize();
+      const auto srcFile = static_cast<uint32_t>(en.decodeBlockSize());
+      const uint64_t srcOffset = en.decodeBlockSize();
+      Deduplicator::getInstance()->restore(out, srcFile, srcOffset, len, mode, diffFound, i);
+      if( diffFound != 0 ) {
+        mode = FDISCARD;
+      }
+    } else if( hasRecursion(type)) {
       FileTmp tmp;
       decompressRecursive(&tmp, len, en, FDECOMPRESS, recursionLevel + 1);
       if( mode != FDISCARD ) {
@@ -1571,39 +1753,96 @@ static auto decompressRecursive(File *out, uint64_t blockSize, Encoder &en, FMod
   return diffFound;
 }
 
-// Decompress or compare a file
+// Decompress or compare a block into a sequential stream.
+// The block is restored in a temporary file first: the transforms may need to read back from their output.
+static auto decompressToStream(File *out, uint64_t blockSize, Encoder &en, FMode fMode) -> uint64_t {
+  FileTmp tmp;
+  decompressRecursive(&tmp, blockSize, en, FDECOMPRESS, 0);
+  tmp.setpos(0);
+  Array<uint8_t> buf(1U << 16U);
+  uint64_t diffFound = 0;
+  for( uint64_t i = 0; i < blockSize && diffFound == 0; ) {
+    const uint64_t n = tmp.blockRead(&buf[0], min(static_cast<uint64_t>(buf.size()), blockSize - i));
+    if( n == 0 ) {
+      break;
+    }
+    if( fMode == FDECOMPRESS ) {
+      out->blockWrite(&buf[0], n);
+    } else {
+      for( uint64_t j = 0; j < n; j++ ) {
+        if( out->getchar() != buf[j] ) {
+          diffFound = i + j + 1;
+          break;
+        }
+      }
+    }
+    i += n;
+  }
+  tmp.close();
+  return diffFound;
+}
+
+// Decompress or compare a file (or a stream, see compressStream())
 static void decompressFile(const char *filename, FMode fMode, Encoder &en) {
   assert(en.getMode() == DECOMPRESS);
   assert(filename && filename[0]);
 
   BlockType blocktype = static_cast<BlockType>(en.decompress());
-  if( blocktype != FILECONTAINER ) {
+  if( blocktype != FILECONTAINER && blocktype != STREAM ) {
     quit("Bad archive.");
   }
   uint64_t fileSize = en.decodeBlockSize();
 
-  FileDisk f;
+  FileDisk fileDisk;
+  FileMapped fileMapped;
+  FileStream fileStream;
+  File *f = FileStream::isStream(filename) ? static_cast<File *>(&fileStream) : fMode == FCOMPARE ? static_cast<File *>(&fileMapped) : &fileDisk;
+  Deduplicator::getInstance()->addFile(filename);
   if( fMode == FCOMPARE ) {
-    f.open(filename, true);
+    f->open(filename, true);
     printf("Comparing");
   } else { //mode==FDECOMPRESS;
-    f.create(filename);
+    f->create(filename);
     printf("Extracting");
   }
-  printf(" %s %" PRIu64 " bytes -> ", filename, fileSize);
+  if( blocktype == STREAM ) {
+    printf(" %s -> ", filename);
+  } else {
+    printf(" %s %" PRIu64 " bytes -> ", filename, fileSize);
+  }
 
   // Decompress/Compare
-  uint64_t r = decompressRecursive(&f, fileSize, en, fMode, 0);
-  if( fMode == FCOMPARE && (r == 0u) && f.getchar() != EOF) {
+  uint64_t r = 0;
+  uint64_t done = 0;
+  while( true ) {
+    r = f->isSeekable() ? decompressRecursive(f, fileSize, en, fMode, 0) : decompressToStream(f, fileSize, en, fMode);
+    if( r != 0 ) {
+      r += done;
+    }
+    done += fileSize;
+    if( blocktype == FILECONTAINER || r != 0 ) {
+      break;
+    }
+    if( en.decompress() != STREAM ) {
+      quit("Bad archive.");
+    }
+    fileSize = en.decodeBlockSize();
+    if( fileSize == 0 ) {
+      break;
+    }
+  }
+  if( fMode == FCOMPARE && (r == 0u) && f->getchar() != EOF) {
     printf("file is longer\n");
   } else if( fMode == FCOMPARE && (r != 0u)) {
     printf("differ at %" PRIu64 "\n", r - 1);
   } else if( fMode == FCOMPARE ) {
     printf("identical\n");
+  } else if( blocktype == STREAM ) {
+    printf("%" PRIu64 " bytes done   \n", done);
   } else {
     printf("done   \n");
   }
-  f.close();
+  f->close();
 }
 
 #endif //PAQ8PX_FILTERS_HPP
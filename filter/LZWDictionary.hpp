@@ -3,13 +3,13 @@
 
 #include "../file/File.hpp"
 #include "LZWEntry.hpp"
+#include "LZWHashTable.hpp"
 #include <cstdint>
 
 class LZWDictionary {
 private:
-    static constexpr int hashSize = 9221;
     LZWentry dictionary[4096] {};
-    short table[hashSize] {};
+    LZWHashTable<13> table;
     uint8_t buffer[4096] {};
 
 public:
@@ -17,7 +17,8 @@ public:
     LZWDictionary();
     void reset();
     auto findEntry(int prefix, int suffix) -> int;
-    void addEntry(int prefix, int suffix, int offset = -1);
+    void addEntry(int prefix, int suffix);
+    void addEntry(int prefix, int suffix, int offset);
     auto dumpEntry(File *f, int code) -> int;
 };
 
@@ -0,0 +1,67 @@
+#ifndef PAQ8PX_LZWHASHTABLE_HPP
+#define PAQ8PX_LZWHASHTABLE_HPP
+
+#include "../Array.hpp"
+#include "../Hash.hpp"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Open addressing hash table from LZW keys ((prefix code << 8) | suffix byte) to codes, shared by the GIF and TIFF LZW transforms.
+ * Slots are tagged with a generation counter so that reset() (a clear code) is O(1), and each slot stores its key, so a lookup
+ * touches only the table (linear probing in a power of 2 sized table).
+ * @tparam hashBits log2 of the number of slots, it should leave the table at most half full (LZW uses at most 4096 codes)
+ */
+template<int hashBits>
+class LZWHashTable {
+private:
+    static constexpr uint32_t mask = (1U << hashBits) - 1;
+
+    struct Slot {
+        uint32_t key;
+        uint16_t code;
+        uint16_t generation;
+    };
+
+    Array<Slot> slots {1U << hashBits};
+    uint16_t generation = 1; /**< slots of older generations are free */
+
+public:
+    void reset() {
+      if( ++generation == 0 ) {
+        memset(&slots[0], 0, sizeof(Slot) << hashBits);
+        generation = 1;
+      }
+    }
+
+    /**
+     * Looks up @ref key.
+     * @param key
+     * @param slot receives the slot of @ref key, or the free slot where it can be added with set()
+     * @return the code of @ref key, or -1 if it is not in the table
+     */
+    auto find(const uint32_t key, uint32_t &slot) -> int {
+      uint32_t i = finalize64(hash(key), hashBits);
+      while( true ) {
+        const Slot &s = slots[i];
+        if( s.generation != generation ) {
+          slot = i;
+          return -1;
+        }
+        if( s.key == key ) {
+          slot = i;
+          return s.code;
+        }
+        i = (i + 1) & mask;
+      }
+    }
+
+    /**
+     * Stores @ref key -> @ref code at @ref slot (as returned by find()), replacing the code of @ref key if it was present.
+     */
+    void set(const uint32_t slot, const uint32_t key, const int code) {
+      slots[slot] = {key, static_cast<uint16_t>(code), generation};
+    }
+};
+
+#endif //PAQ8PX_LZWHASHTABLE_HPP
@@ -0,0 +1,78 @@
+#ifndef PAQ8PX_MODELSELECTION_HPP
+#define PAQ8PX_MODELSELECTION_HPP
+
+#include "../file/File.hpp"
+#include "../utils.hpp"
+#include <cstdint>
+
+// Pick the optional models for a block (compression switch "p").
+// A few evenly spaced chunks of the block are sampled and classified as text or binary data, then the models that
+// gain almost nothing on such data are masked out:
+// - text: SparseModel (it is slightly worse than nothing on text) and XMLModel, unless there is markup,
+// - binary: CharGroupModel, DmcForest and XMLModel (less than 0.1% on binaries and bytecode),
+// while ExeModel and LinearPredictionModel are never run on text blocks anyway.
+// Only DEFAULT, TEXT, TEXT_EOL and EXE blocks are classified. The other types that reach the optional models in
+// ContextModel::p() (HDR, JPEG outside of the scans, GIF, ZLIB, CD etc. when not transformed) run all of them.
+// Returns the mask to signal in a MODELMASK block, or 0 to keep the current mask: when the block is too small to be
+// worth a MODELMASK block, or when it is an image or audio block, which never runs the optional models.
+// The position of the input file is restored.
+static auto selectModels(File *in, const uint64_t len, const BlockType type) -> uint32_t {
+  static constexpr uint64_t minBlockSize = 1024;
+  static constexpr uint32_t chunkSize = 4096;
+  static constexpr uint32_t chunkCount = 16;
+  static constexpr uint32_t textualPercent = 95;
+  static constexpr uint32_t bytesPerMarkup = 512; /**< at least one '<' per this many bytes means markup */
+  static constexpr uint32_t textMask = MODEL_ALL & ~MODEL_SPARSE;
+  static constexpr uint32_t binaryMask = MODEL_ALL & ~(MODEL_CHARGROUP | MODEL_DMC | MODEL_XML);
+
+  if( type == IMAGE1 || type == IMAGE4 || type == IMAGE8 || type == IMAGE8GRAY || type == IMAGE24 || type == IMAGE32 || isPNG(type)) {
+    return 0;
+  }
+#ifndef DISABLE_AUDIOMODEL
+  if( type == AUDIO || type == AUDIO_LE ) {
+    return 0;
+  }
+#endif
+  if( type != DEFAULT && type != TEXT && type != TEXT_EOL && type != EXE ) {
+    return MODEL_ALL;
+  }
+  if( len < minBlockSize ) {
+    return 0;
+  }
+  const uint64_t begin = in->curPos();
+  const uint32_t chunks = len <= chunkSize * chunkCount ? 1 : chunkCount; // a small block is read whole
+  const uint32_t chunkLength = chunks == 1 ? static_cast<uint32_t>(len) : chunkSize;
+  const uint64_t step = len / chunks;
+  uint32_t textual = 0; // printable ASCII, whitespace and the bytes of well-formed UTF-8 sequences
+  uint32_t markup = 0;
+  for( uint32_t i = 0; i < chunks; i++ ) {
+    in->setpos(begin + i * step);
+    uint32_t pending = 0; // continuation bytes still expected in a UTF-8 sequence
+    for( uint32_t j = 0; j < chunkLength; j++ ) {
+      const int c = in->getchar();
+      if( pending > 0 && (c & 0xC0) == 0x80 ) {
+        pending--;
+        textual++;
+        continue;
+      }
+      pending = 0;
+      if((c >= 32 && c < 127) || c == '\n' || c == '\r' || c == '\t' ) {
+        textual++;
+        markup += static_cast<uint32_t>(c == '<');
+      } else if( c >= 0xC2 && c <= 0xF4 ) {
+        pending = c < 0xE0 ? 1 : c < 0xF0 ? 2 : 3;
+        textual++;
+      }
+    }
+  }
+  in->setpos(begin);
+
+  const uint32_t sampled = chunks * chunkLength;
+  const bool isText = type == TEXT || type == TEXT_EOL || (type != EXE && textual * 100 >= sampled * textualPercent);
+  if( !isText ) {
+    return binaryMask;
+  }
+  return markup * bytesPerMarkup >= sampled ? textMask : textMask & ~MODEL_XML;
+}
+
+#endif //PAQ8PX_MODELSELECTION_HPP
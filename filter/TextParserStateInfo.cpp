@@ -1,4 +1,5 @@
 #include "TextParserStateInfo.hpp"
+#include "../utils.hpp"
 
 TextParserStateInfo *TextParserStateInfo::mPInstance = nullptr;
 
@@ -66,4 +67,77 @@ void TextParserStateInfo::removeFirst() {
     _end.popBack();
     _EOLType.popBack();
   }
-}
\ No newline at end of file
+}
+/**
+ * Applies the invalidCount adaptation of @ref count consecutive valid (single byte) characters.
+ */
+void TextParserStateInfo::decay(uint32_t count) {
+  while( count > 0 && invalidCount != 0 ) {
+    invalidCount = invalidCount * (TEXT_ADAPT_RATE - 1) / TEXT_ADAPT_RATE;
+    count--;
+  }
+}
+
+/**
+ * Feeds @ref length bytes to the parser.
+ * Runs of printable ASCII characters (0x20-0x7e) are checked 8 bytes at a time: they keep the state valid, so only the
+ * invalidCount adaptation and the end of the block need updating. Everything else goes through the UTF8 automaton byte by byte.
+ * @param data the bytes to parse
+ * @param length number of bytes
+ * @param pos position of the first byte in the block
+ * @param prevByte the byte preceding the first one (for CRLF detection), 0 at the beginning of the block
+ */
+void TextParserStateInfo::parse(const uint8_t *data, const uint32_t length, const uint64_t pos, uint8_t prevByte) {
+  constexpr uint64_t ones = 0x0101010101010101ULL;
+  constexpr uint64_t highBits = 0x8080808080808080ULL;
+  uint32_t i = 0;
+  while( i < length ) {
+    if( UTF8State == utf8Accept && i + 8 <= length ) {
+      uint64_t w = 0;
+      memcpy(&w, &data[i], 8);
+      // high bit set in the lowest byte that is >= 0x80, < 0x20 or == 0x7f (bits above it may be false positives)
+      const uint64_t del = w ^ (ones * 0x7f);
+      const uint64_t special = (w | ((w - ones * 0x20) & ~w) | ((del - ones) & ~del)) & highBits;
+      const uint32_t printable = special == 0 ? 8 : static_cast<uint32_t>(__builtin_ctzll(special)) >> 3U;
+      if( printable > 0 ) {
+        decay(printable);
+        if( invalidCount == 0 ) {
+          setEnd(pos + i + printable - 1);
+        }
+        i += printable;
+        prevByte = data[i - 1];
+        continue;
+      }
+    }
+    const uint8_t c = data[i];
+    const uint32_t t = utf8StateTable[c];
+    UTF8State = utf8StateTable[256 + UTF8State + t];
+    if( UTF8State == utf8Accept ) { // proper end of a valid utf8 sequence
+      if( c == NEW_LINE ) {
+        if( prevByte != CARRIAGE_RETURN ) {
+          setEolType(2); // mixed or LF-only
+        } else if( eolType() == 0 ) {
+          setEolType(1); // CRLF-only
+        }
+      }
+      decay(1);
+      if( invalidCount == 0 ) {
+        setEnd(pos + i); // a possible end of block position
+      }
+    } else if( UTF8State == utf8Reject ) { // illegal state
+      invalidCount = invalidCount * (TEXT_ADAPT_RATE - 1) / TEXT_ADAPT_RATE + TEXT_ADAPT_RATE;
+      UTF8State = utf8Accept; // reset state
+      if( validLength() < TEXT_MIN_SIZE ) {
+        reset(pos + i + 1); // it's not text (or not long enough) - start over
+      } else if( invalidCount >= TEXT_MAX_MISSES * TEXT_ADAPT_RATE ) {
+        if( validLength() < TEXT_MIN_SIZE ) {
+          reset(pos + i + 1); // it's not text (or not long enough) - start over
+        } else { // Commit text block validation
+          next(pos + i + 1);
+        }
+      }
+    }
+    prevByte = c;
+    i++;
+  }
+}
@@ -56,7 +56,10 @@ public:
     auto validLength() -> uint64_t;
     void next(uint64_t startPos);
     void removeFirst();
+    void parse(const uint8_t *data, uint32_t length, uint64_t pos, uint8_t prevByte);
 private:
+    void decay(uint32_t count);
+
     TextParserStateInfo() : _start(1), _end(1), _EOLType(1) {}
 
     /**
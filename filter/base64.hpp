@@ -27,76 +27,110 @@ namespace base64 {
     }
 
     static constexpr char table1[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    static constexpr uint8_t newLine = 0x80; /**< class of CR and LF in DecodeTable */
+    static constexpr uint8_t invalid = 0xFF; /**< class of all other characters (including '=') in DecodeTable */
+
+    /**
+     * Maps a character to its 6-bit value in @ref table1, or to @ref newLine or @ref invalid.
+     */
+    struct DecodeTable {
+        uint8_t value[256];
+
+        constexpr DecodeTable() : value() {
+          for( int c = 0; c < 256; c++ ) {
+            value[c] = invalid;
+          }
+          for( int i = 0; i < 64; i++ ) {
+            value[static_cast<uint8_t>(table1[i])] = i;
+          }
+          value[10] = value[13] = newLine;
+        }
+    };
+
+    static constexpr DecodeTable decodeTable {};
 } // namespace base64
 
 class Base64Filter : Filter {
 private:
-    static auto valueB(char c) -> char {
-      const char *p = strchr(base64::table1, c);
-      if( p != nullptr ) {
-        return static_cast<char>(p - base64::table1);
-      }
-      return 0;
-    }
+    static constexpr uint32_t bufferSize = 1U << 16U;
 
-    static auto isBase64(uint8_t c) -> bool {
-      return (base64::isalnum(c) || (c == '+') || (c == '/') || (c == 10) || (c == 13));
+    static void decodeQuad(const uint8_t *v, uint8_t *dst) {
+      dst[0] = (v[0] << 2U) + ((v[1] & 0x30U) >> 4U);
+      dst[1] = ((v[1] & 0xfU) << 4U) + ((v[2] & 0x3cU) >> 2U);
+      dst[2] = ((v[2] & 0x3U) << 6U) + v[3];
     }
 
 public:
     void encode(File *in, File *out, uint64_t size, int  /*info*/, int & /*headerSize*/) override {
       uint64_t inLen = 0;
       int i = 0;
-      int b = 0;
       uint32_t lfp = 0;
       int tlf = 0;
-      char src[4];
+      uint8_t src[4];
       uint64_t b64Mem = (size >> 2U) * 3 + 10;
       Array<uint8_t> ptr(b64Mem);
-      int olen = 5;
-
-      while( b = in->getchar(), inLen++, (b != '=') && isBase64(b) && inLen <= size ) {
-        if( b == 13 || b == 10 ) {
-          if( lfp == 0 ) {
-            lfp = inLen;
-            tlf = b;
+      Array<uint8_t> buf(bufferSize);
+      uint64_t olen = 5;
+      const uint8_t *value = base64::decodeTable.value;
+
+      bool done = false;
+      while( !done && inLen < size ) {
+        const auto n = static_cast<uint32_t>(in->blockRead(&buf[0], min(static_cast<uint64_t>(bufferSize), size - inLen)));
+        if( n == 0 ) {
+          break;
+        }
+        uint32_t k = 0;
+        while( k < n ) {
+          // fast path: whole quads of base64 characters
+          if( i == 0 ) {
+            while( k + 4 <= n ) {
+              const uint8_t v[4] = {value[buf[k]], value[buf[k + 1]], value[buf[k + 2]], value[buf[k + 3]]};
+              if((v[0] | v[1] | v[2] | v[3]) >= 64 ) {
+                break;
+              }
+              decodeQuad(v, &ptr[olen]);
+              olen += 3;
+              k += 4;
+            }
+            if( k == n ) {
+              break;
+            }
           }
-          if( tlf != b ) {
-            tlf = 0;
+          const uint8_t b = buf[k++];
+          const uint8_t v = value[b];
+          if( v == base64::newLine ) {
+            if( lfp == 0 ) {
+              lfp = inLen + k;
+              tlf = b;
+            }
+            if( tlf != b ) {
+              tlf = 0;
+            }
+            continue;
           }
-          continue;
-        }
-        src[i++] = b;
-        if( i == 4 ) {
-          for( int j = 0; j < 4; j++ ) {
-            src[j] = valueB(src[j]);
+          if( v == base64::invalid ) { // '=' or not base64
+            done = true;
+            break;
+          }
+          src[i++] = v;
+          if( i == 4 ) {
+            decodeQuad(src, &ptr[olen]);
+            olen += 3;
+            i = 0;
           }
-          src[0] = (src[0] << 2U) + ((src[1] & 0x30U) >> 4U);
-          src[1] = ((src[1] & 0xf) << 4U) + ((src[2] & 0x3CU) >> 2U);
-          src[2] = ((src[2] & 0x3) << 6U) + src[3];
-
-          ptr[olen++] = src[0];
-          ptr[olen++] = src[1];
-          ptr[olen++] = src[2];
-          i = 0;
         }
+        inLen += n;
       }
 
       if( i != 0 ) {
         for( int j = i; j < 4; j++ ) {
           src[j] = 0;
         }
-
-        for( int j = 0; j < 4; j++ ) {
-          src[j] = valueB(src[j]);
-        }
-
-        src[0] = (src[0] << 2U) + ((src[1] & 0x30U) >> 4U);
-        src[1] = ((src[1] & 0xfU) << 4U) + ((src[2] & 0x3cU) >> 2U);
-        src[2] = ((src[2] & 0x3U) << 6U) + src[3];
-
+        uint8_t dst[3];
+        decodeQuad(src, dst);
         for( int j = 0; (j < i - 1); j++ ) {
-          ptr[olen++] = src[j];
+          ptr[olen++] = dst[j];
         }
       }
       ptr[0] = lfp & 255U; //nl length
@@ -115,10 +149,8 @@ public:
       out->blockWrite(&ptr[0], olen);
     }
 
-    auto decode(File *in, File *out, FMode fMode, uint64_t /*size*/, uint64_t &diffFound) -> uint64_t override {
-      uint8_t inn[3];
+    auto decode(File *in, File *out, FMode fMode, uint64_t size, uint64_t &diffFound) -> uint64_t override {
       int i = 0;
-      int len = 0;
       int blocksOut = 0;
       int fle = 0;
       int lineSize = in->getchar();
@@ -134,39 +166,32 @@ public:
       } else {
         tlf = 0;
       }
+      Array<uint8_t> data(size > 5 ? size - 5 : 0);
+      const uint64_t dataLen = data.size() > 0 ? in->blockRead(&data[0], data.size()) : 0;
+      uint64_t dataPos = 0;
 
       while( fle < outLen ) {
-        len = 0;
-        for( i = 0; i < 3; i++ ) {
-          int c = in->getchar();
-          if( c != EOF) {
-            inn[i] = c;
-            len++;
-          } else {
-            inn[i] = 0;
-          }
-        }
-        if( len != 0 ) {
-          uint8_t in0 = inn[0];
-          uint8_t in1 = inn[1];
-          uint8_t in2 = inn[2];
-          ptr[fle++] = (base64::table1[in0 >> 2U]);
-          ptr[fle++] = (base64::table1[((in0 & 0x03U) << 4U) | ((in1 & 0xf0U) >> 4U)]);
-          ptr[fle++] = ((len > 1 ? base64::table1[((in1 & 0x0fU) << 2U) | ((in2 & 0xc0U) >> 6U)] : '='));
-          ptr[fle++] = ((len > 2 ? base64::table1[in2 & 0x3fU] : '='));
-          blocksOut++;
-        }
-        else {
-          if (fMode == FDECOMPRESS) {
+        if( dataPos == dataLen ) {
+          if( fMode == FDECOMPRESS ) {
             quit("Unexpected Base64 decoding state");
-          }
-          else if (fMode == FCOMPARE) {
+          } else if( fMode == FCOMPARE ) {
             diffFound = fle;
             break; // give up
           }
+          break;
         }
+        const auto len = static_cast<int>(min(static_cast<uint64_t>(3), dataLen - dataPos));
+        const uint8_t in0 = data[dataPos];
+        const uint8_t in1 = len > 1 ? data[dataPos + 1] : 0;
+        const uint8_t in2 = len > 2 ? data[dataPos + 2] : 0;
+        dataPos += len;
+        ptr[fle++] = (base64::table1[in0 >> 2U]);
+        ptr[fle++] = (base64::table1[((in0 & 0x03U) << 4U) | ((in1 & 0xf0U) >> 4U)]);
+        ptr[fle++] = ((len > 1 ? base64::table1[((in1 & 0x0fU) << 2U) | ((in2 & 0xc0U) >> 6U)] : '='));
+        ptr[fle++] = ((len > 2 ? base64::table1[in2 & 0x3fU] : '='));
+        blocksOut++;
         if( blocksOut >= (lineSize / 4) && lineSize != 0 ) { //no lf if lineSize==0
-          if((blocksOut != 0) && !in->eof() && fle <= outLen ) { //no lf if eof
+          if( dataPos < dataLen && fle <= outLen ) { //no lf if eof
             if( tlf != 0 ) {
               ptr[fle++] = tlf;
             } else {
@@ -181,11 +206,19 @@ public:
       if( fMode == FDECOMPRESS ) {
         out->blockWrite(&ptr[0], outLen);
       } else if( fMode == FCOMPARE ) {
-        for( i = 0; i < outLen; i++ ) {
-          uint8_t b = ptr[i];
-          if( b != out->getchar() && (diffFound == 0u)) {
-            diffFound = static_cast<int>(out->curPos());
+        Array<uint8_t> buf(bufferSize);
+        for( i = 0; i < outLen; ) {
+          const uint64_t pos = out->curPos();
+          const auto n = static_cast<int>(min(static_cast<uint64_t>(bufferSize), static_cast<uint64_t>(outLen - i)));
+          const auto got = static_cast<int>(out->blockRead(&buf[0], n));
+          for( int j = 0; j < n && diffFound == 0u; j++ ) {
+            if( j >= got ) {
+              diffFound = pos + got; // reading past the end
+            } else if( ptr[i + j] != buf[j] ) {
+              diffFound = pos + j + 1;
+            }
           }
+          i += n;
         }
       }
       return outLen;
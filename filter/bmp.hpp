@@ -1,6 +1,7 @@
 #ifndef PAQ8PX_BMP_HPP
 #define PAQ8PX_BMP_HPP
 
+#include "../Array.hpp"
 #include "Filter.hpp"
 #include "../file/File.hpp"
 #include <cstdint>
@@ -15,6 +16,7 @@ class BmpFilter : public Filter {
 private:
     int width = 0;
     static constexpr int rgb565MinRun = 63;
+    static constexpr uint32_t bufferSize = 1U << 16U; /**< the image is transformed in blocks of whole rows of about this size */
 public:
     void setWidth(int w) {
       width = w;
@@ -22,17 +24,23 @@ public:
 
     void encode(File *in, File *out, uint64_t size, int width, int & /*headerSize*/) override {
       Shared *shared = Shared::getInstance();
-      uint32_t r = 0;
-      uint32_t g = 0;
-      uint32_t b = 0;
+      const bool skipRgb = (shared->options & OPTION_SKIPRGB) != 0u;
+      const int rows = static_cast<int>(size / width);
+      const int rowsPerBlock = max(1, static_cast<int>(bufferSize / width));
+      Array<uint8_t> blk(static_cast<uint64_t>(rowsPerBlock) * width);
       uint32_t total = 0;
       auto isPossibleRgb565 = true;
-      for( int i = 0; i < static_cast<int>(size / width); i++ ) {
-        for( int j = 0; j < width / 3; j++ ) {
-          b = in->getchar();
-          g = in->getchar();
-          r = in->getchar();
-          if( isPossibleRgb565 ) {
+      for( int i = 0; i < rows; i += rowsPerBlock ) {
+        const uint64_t blkSize = static_cast<uint64_t>(min(rowsPerBlock, rows - i)) * width;
+        in->blockRead(&blk[0], blkSize);
+        for( uint64_t row = 0; row < blkSize; row += width ) {
+          uint8_t *pixel = &blk[row];
+          int j = 0;
+          // while RGB565 data is possible the pixels are processed one by one, then the remainder of the row in a simple loop
+          for( ; j < width / 3 && isPossibleRgb565; j++, pixel += 3 ) {
+            uint32_t b = pixel[0];
+            uint32_t g = pixel[1];
+            uint32_t r = pixel[2];
             int pTotal = total;
             total = min(total + 1, 0xFFFF) *
                     static_cast<int>((b & 7U) == ((b & 8U) - ((b >> 3U) & 1U)) && (g & 3U) == ((g & 4U) - ((g >> 2U) & 1U)) &&
@@ -43,17 +51,35 @@ public:
               r ^= (r & 8U) - ((r >> 3U) & 1U);
             }
             isPossibleRgb565 = total > 0;
+            pixel[0] = g;
+            pixel[1] = skipRgb ? r : g - r;
+            pixel[2] = skipRgb ? b : g - b;
+          }
+          const int pixels = width / 3 - j;
+          if( skipRgb ) {
+            for( int k = 0; k < pixels; k++, pixel += 3 ) {
+              const uint8_t b = pixel[0];
+              pixel[0] = pixel[1];
+              pixel[1] = pixel[2];
+              pixel[2] = b;
+            }
+          } else {
+            for( int k = 0; k < pixels; k++, pixel += 3 ) {
+              const uint8_t b = pixel[0];
+              const uint8_t g = pixel[1];
+              const uint8_t r = pixel[2];
+              pixel[0] = g;
+              pixel[1] = g - r;
+              pixel[2] = g - b;
+            }
           }
-          out->putChar(g);
-          out->putChar((shared->options & OPTION_SKIPRGB) != 0u ? r : g - r);
-          out->putChar((shared->options & OPTION_SKIPRGB) != 0u ? b : g - b);
-        }
-        for( int j = 0; j < width % 3; j++ ) {
-          out->putChar(in->getchar());
         }
+        out->blockWrite(&blk[0], blkSize);
       }
-      for( int i = size % width; i > 0; i-- ) {
-        out->putChar(in->getchar());
+      const auto tail = static_cast<uint32_t>(size % width);
+      if( tail > 0 ) {
+        in->blockRead(&blk[0], tail);
+        out->blockWrite(&blk[0], tail);
       }
     }
 
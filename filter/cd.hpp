@@ -1,13 +1,17 @@
 #ifndef PAQ8PX_CD_HPP
 #define PAQ8PX_CD_HPP
 
+#include "../Array.hpp"
 #include "Filter.hpp"
 #include "ecc.hpp"
+#include <cstring>
 
 /**
- * @todo Large file support
+ * CD-ROM sector transform: removes the sync pattern, the addresses and the ECC/EDC data that can be recomputed.
  */
 class CdFilter : Filter {
+private:
+    static constexpr uint32_t sectorsPerBatch = 16;
 public:
     static auto expandCdSector(uint8_t *data, int address, int test) -> int {
       uint8_t d2[2352];
@@ -62,17 +66,14 @@ public:
         for( int i = 0; i < 4; i++ ) {
           d2[2064 + 8 * static_cast<int>(fMode == 2) + i] = (edc >> (8 * i)) & 0xffU;
         }
-        eccCompute(d2 + 12, 86, 24, 2, 86, d2 + 2076);
-        eccCompute(d2 + 12, 52, 43, 86, 88, d2 + 2248);
+        eccComputePQ(d2);
         if( fMode == 2 ) {
           d2[12] = d2[1], d2[13] = d2[2], d2[14] = d2[3], d2[15] = 2;
           d2[1] = d2[2] = d2[3] = 255;
         }
       }
-      for( int i = 0; i < 2352; i++ ) {
-        if( d2[i] != data[i] && (test != 0)) {
-          form = 2;
-        }
+      if( test != 0 && memcmp(d2, data, 2352) != 0 ) {
+        form = 2;
       }
       if( form == 2 ) {
         for( int i = 24; i < 2348; i++ ) {
@@ -83,12 +84,10 @@ public:
           d2[2348 + i] = (edc >> (8 * i)) & 0xffu; //EDC
         }
       }
-      for( int i = 0; i < 2352; i++ ) {
-        if( d2[i] != data[i] && (test != 0)) {
-          return 0;
-        }
-        data[i] = d2[i];
+      if( test != 0 && memcmp(d2, data, 2352) != 0 ) {
+        return 0;
       }
+      memcpy(data, d2, 2352);
       return fMode + form - 1;
     }
 
@@ -122,7 +121,6 @@ public:
     }
 
     /**
-     * @todo Large file support
      * @param in
      * @param out
      * @param fMode
@@ -137,21 +135,36 @@ public:
       uint64_t nextBlockPos = 0;
       int address = -1;
       int dataSize = 0;
+      Array<uint8_t> batch(sectorsPerBatch * block); //expanded sectors are written (or compared) in batches
+      Array<uint8_t> cmp(fMode == FCOMPARE ? sectorsPerBatch * block : 0);
+      uint32_t batchSize = 0;
+      auto emit = [&](const uint8_t *data, const uint32_t length) {
+        if( fMode == FDECOMPRESS ) {
+          out->blockWrite(const_cast<uint8_t *>(data), length);
+        } else if( fMode == FCOMPARE ) {
+          const auto n = static_cast<uint32_t>(out->blockRead(&cmp[0], length));
+          for( uint32_t j = 0; j < length && diffFound == 0; ++j ) {
+            if( j >= n || data[j] != cmp[j] ) {
+              diffFound = nextBlockPos + j + 1;
+            }
+          }
+        }
+        nextBlockPos += length;
+      };
+      auto flush = [&]() {
+        if( batchSize > 0 ) {
+          emit(&batch[0], batchSize);
+          batchSize = 0;
+        }
+      };
       uint64_t residual = (in->getchar() << 8U) + in->getchar();
       size -= 2;
       while( i < size ) {
         if( size - i == residual ) { //residual data after last sector
+          flush();
           in->blockRead(blk, residual);
-          if( fMode == FDECOMPRESS ) {
-            out->blockWrite(blk, residual);
-          } else if( fMode == FCOMPARE ) {
-            for( int j = 0; j < static_cast<int>(residual); ++j ) {
-              if( blk[j] != out->getchar() && (diffFound == 0u)) {
-                diffFound = nextBlockPos + j + 1;
-              }
-            }
-          }
-          return nextBlockPos + residual;
+          emit(blk, residual);
+          return nextBlockPos;
         }
         if( i == 0 ) { //first sector
           in->blockRead(blk + 12,
@@ -176,17 +189,13 @@ public:
           i += 4;
         }
         expandCdSector(blk, address, 0);
-        if( fMode == FDECOMPRESS ) {
-          out->blockWrite(blk, block);
-        } else if( fMode == FCOMPARE ) {
-          for( int j = 0; j < block; ++j ) {
-            if( blk[j] != out->getchar() && (diffFound == 0u)) {
-              diffFound = nextBlockPos + j + 1;
-            }
-          }
+        memcpy(&batch[batchSize], blk, block);
+        batchSize += block;
+        if( batchSize == batch.size()) {
+          flush();
         }
-        nextBlockPos += block;
       }
+      flush();
       return nextBlockPos;
     }
 };
@@ -0,0 +1,266 @@
+#ifndef PAQ8PX_DEDUP_HPP
+#define PAQ8PX_DEDUP_HPP
+
+#include "../Array.hpp"
+#include "../Hash.hpp"
+#include "../VLI.hpp"
+#include "../file/FileMapped.hpp"
+#include "../file/FileName.hpp"
+#include "Filter.hpp"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Content-defined chunk deduplication.
+ *
+ * Before modeling, each input file is cut into variable sized chunks using a gear rolling hash, so that chunk boundaries
+ * depend on the content only and survive insertions/deletions. Every chunk is fingerprinted and looked up in an index that
+ * spans all files of the archive. A chunk that was already seen (and whose content is verified to be byte-identical) is
+ * replaced by a DEDUP block referencing the earlier occurrence (see compressDeduplicated()).
+ * The decompressor restores such a block by copying from the (already restored) source file.
+ */
+class Deduplicator {
+public:
+    static constexpr uint32_t MIN_CHUNK_SIZE = 2048;
+    static constexpr uint32_t MAX_CHUNK_SIZE = 65536;
+    static constexpr uint64_t CHUNK_MASK = (8192 - 1); /**< average chunk size is about MIN_CHUNK_SIZE + 8 KB */
+
+    /**
+     * A run of bytes in the current file: either a literal range to be compressed, or a reference to earlier content.
+     */
+    struct Segment {
+        uint64_t begin; /**< position in the current file */
+        uint64_t length;
+        uint64_t srcOffset; /**< position in the source file (references only) */
+        uint32_t srcFile; /**< index of the source file (references only) */
+        bool isReference;
+    };
+
+private:
+    struct Chunk {
+        uint64_t fingerprint;
+        uint64_t offset;
+        uint32_t length;
+        uint32_t fileIndex;
+    };
+
+    Array<FileName *> fileNames {0}; /**< all files registered so far (in archive order) */
+    Array<Chunk> chunks {0}; /**< fingerprints of unique chunks */
+    Array<uint32_t> index {0}; /**< open addressing hash table: fingerprint -> chunk index + 1 */
+    uint32_t indexMask = 0;
+    uint64_t gear[256] {};
+    FileMapped srcFile; /**< the most recently opened source file for verifying and restoring references */
+    int srcFileIndex = -1;
+
+    Deduplicator() {
+      for( int i = 0; i < 256; i++ ) {
+        gear[i] = hash(i, 0x6765617200ULL); // "gear"
+      }
+    }
+
+    ~Deduplicator() {
+      srcFile.close();
+      for( uint64_t i = 0; i < fileNames.size(); i++ ) {
+        delete fileNames[i];
+      }
+    }
+
+    void grow() {
+      const uint32_t newSize = indexMask == 0 ? 1U << 16U : (indexMask + 1) * 2;
+      index.resize(newSize);
+      memset(&index[0], 0, newSize * sizeof(uint32_t));
+      indexMask = newSize - 1;
+      for( uint32_t i = 0; i < chunks.size(); i++ ) {
+        insert(i);
+      }
+    }
+
+    void insert(const uint32_t chunkIndex) {
+      uint32_t slot = finalize64(chunks[chunkIndex].fingerprint, 32) & indexMask;
+      while( index[slot] != 0 ) {
+        slot = (slot + 1) & indexMask;
+      }
+      index[slot] = chunkIndex + 1;
+    }
+
+    auto find(const uint64_t fingerprint, const uint32_t length) -> Chunk * {
+      if( indexMask == 0 ) {
+        return nullptr;
+      }
+      uint32_t slot = finalize64(fingerprint, 32) & indexMask;
+      while( index[slot] != 0 ) {
+        Chunk *chunk = &chunks[index[slot] - 1];
+        if( chunk->fingerprint == fingerprint && chunk->length == length ) {
+          return chunk;
+        }
+        slot = (slot + 1) & indexMask;
+      }
+      return nullptr;
+    }
+
+    auto openSource(const uint32_t fileIndex) -> File * {
+      if( srcFileIndex != static_cast<int>(fileIndex)) {
+        srcFile.close();
+        srcFile.open(fileNames[fileIndex]->c_str(), true);
+        srcFileIndex = fileIndex;
+      }
+      return &srcFile;
+    }
+
+    /**
+     * Verify that @ref length bytes at @ref pos in @ref in are identical to the referenced chunk (fingerprints may collide).
+     */
+    auto verify(File *in, const uint64_t pos, const Chunk *chunk, const uint32_t length) -> bool {
+      Array<uint8_t> a(length);
+      Array<uint8_t> b(length);
+      const uint64_t savedPos = in->curPos();
+      in->setpos(pos);
+      const bool readOk = in->blockRead(&a[0], length) == length;
+      in->setpos(savedPos);
+      if( !readOk ) {
+        return false;
+      }
+      File *src = openSource(chunk->fileIndex);
+      src->setpos(chunk->offset);
+      return src->blockRead(&b[0], length) == length && memcmp(&a[0], &b[0], length) == 0;
+    }
+
+    static void addSegment(Array<Segment> &segments, const Segment &s) {
+      if( segments.size() > 0 ) {
+        Segment &last = segments[segments.size() - 1];
+        if( last.isReference == s.isReference && last.begin + last.length == s.begin &&
+            (!s.isReference || (last.srcFile == s.srcFile && last.srcOffset + last.length == s.srcOffset))) {
+          last.length += s.length;
+          return;
+        }
+      }
+      segments.pushBack(s);
+    }
+
+public:
+    static auto getInstance() -> Deduplicator * {
+      static Deduplicator instance;
+      return &instance;
+    }
+
+    /**
+     * Registers the next file of the archive (both when compressing and decompressing).
+     * Files must be registered in the same order on both sides.
+     * @param filename
+     * @return the index of the file
+     */
+    auto addFile(const char *filename) -> uint32_t {
+      auto *fn = new FileName();
+      *fn += filename;
+      fileNames.pushBack(fn);
+      return static_cast<uint32_t>(fileNames.size() - 1);
+    }
+
+    /**
+     * Cuts @ref size bytes of @ref in (starting at the current position) into content-defined chunks and splits the range
+     * into literal and reference segments. Unique chunks are added to the index.
+     * The file position of @ref in is restored.
+     * @param in the current file (must be registered with addFile() already)
+     * @param size number of bytes to process
+     * @param segments the resulting segments in file order
+     */
+    void analyze(File *in, const uint64_t size, Array<Segment> &segments) {
+      const auto fileIndex = static_cast<uint32_t>(fileNames.size() - 1);
+      const uint64_t start = in->curPos();
+      constexpr uint32_t bufSize = 1U << 20U;
+      Array<uint8_t> buf(bufSize);
+      Array<Chunk> found(0); // chunk boundaries and fingerprints of this file
+      uint64_t chunkStart = 0;
+      uint64_t rollingHash = 0;
+      uint64_t fingerprint = 0;
+      uint64_t pos = 0;
+      while( pos < size ) {
+        const auto n = static_cast<uint32_t>(in->blockRead(&buf[0], min(static_cast<uint64_t>(bufSize), size - pos)));
+        if( n == 0 ) {
+          break;
+        }
+        for( uint32_t i = 0; i < n; i++ ) {
+          const uint8_t c = buf[i];
+          rollingHash = (rollingHash << 1U) + gear[c];
+          fingerprint = (fingerprint + c + 1) * PHI64;
+          fingerprint ^= fingerprint >> 29U;
+          const uint64_t length = pos + i + 1 - chunkStart;
+          if((length >= MIN_CHUNK_SIZE && (rollingHash >> 40U & CHUNK_MASK) == 0) || length == MAX_CHUNK_SIZE || pos + i + 1 == size ) {
+            found.pushBack({fingerprint, chunkStart, static_cast<uint32_t>(length), fileIndex});
+            chunkStart = pos + i + 1;
+            rollingHash = 0;
+            fingerprint = 0;
+          }
+        }
+        pos += n;
+      }
+      if( chunkStart < pos ) { // premature end of file
+        found.pushBack({fingerprint, chunkStart, static_cast<uint32_t>(pos - chunkStart), fileIndex});
+      }
+      in->setpos(start);
+
+      for( uint64_t i = 0; i < found.size(); i++ ) {
+        const Chunk &chunk = found[i];
+        Chunk *match = chunk.length >= MIN_CHUNK_SIZE ? find(chunk.fingerprint, chunk.length) : nullptr;
+        if( match != nullptr && verify(in, start + chunk.offset, match, chunk.length)) {
+          addSegment(segments, {chunk.offset, chunk.length, match->offset, match->fileIndex, true});
+        } else {
+          addSegment(segments, {chunk.offset, chunk.length, 0, 0, false});
+          if( chunk.length >= MIN_CHUNK_SIZE && find(chunk.fingerprint, chunk.length) == nullptr ) {
+            if((chunks.size() + 1) * 2 > indexMask ) {
+              grow();
+            }
+            chunks.pushBack({chunk.fingerprint, start + chunk.offset, chunk.length, fileIndex});
+            insert(static_cast<uint32_t>(chunks.size() - 1));
+          }
+        }
+      }
+      in->setpos(start);
+    }
+
+    /**
+     * Restores @ref len bytes of a DEDUP block from the referenced file into @ref out (or compares it with @ref out).
+     * @param out the current file
+     * @param fileIndex the index of the referenced file
+     * @param offset the position in the referenced file
+     * @param len number of bytes to restore
+     * @param fMode FDECOMPRESS, FCOMPARE or FDISCARD
+     * @param diffFound position of the first mismatch + 1 (in FCOMPARE mode)
+     * @param outOffset position of the block in the current file (for reporting mismatches)
+     */
+    void restore(File *out, const uint32_t fileIndex, const uint64_t offset, const uint64_t len, const FMode fMode, uint64_t &diffFound,
+                 const uint64_t outOffset) {
+      if( fMode == FDISCARD ) {
+        return;
+      }
+      if( fileIndex >= fileNames.size()) {
+        quit("Bad archive.");
+      }
+      constexpr uint32_t bufSize = 1U << 16U;
+      Array<uint8_t> buf(bufSize);
+      const bool isCurrentFile = fileIndex == fileNames.size() - 1;
+      File *src = isCurrentFile ? out : openSource(fileIndex);
+      for( uint64_t done = 0; done < len; ) {
+        const auto n = static_cast<uint32_t>(min(static_cast<uint64_t>(bufSize), len - done));
+        const uint64_t outPos = out->curPos();
+        src->setpos(offset + done);
+        if( src->blockRead(&buf[0], n) != n ) {
+          quit("Bad archive.");
+        }
+        out->setpos(outPos);
+        if( fMode == FDECOMPRESS ) {
+          out->blockWrite(&buf[0], n);
+        } else {
+          for( uint32_t j = 0; j < n; j++ ) {
+            if( out->getchar() != buf[j] && diffFound == 0 ) {
+              diffFound = outOffset + done + j + 1;
+              return;
+            }
+          }
+        }
+        done += n;
+      }
+    }
+};
+
+#endif //PAQ8PX_DEDUP_HPP
@@ -7,11 +7,13 @@
 // ** UNECM - Decoder for ECM (Error code Modeler) format.
 // ** version 1.0
 // ** Copyright (c) 2002 Neill Corlett
+// The EDC is computed slice-by-8, the P/Q parities are computed column-parallel (see eccCompute()).
 
 /* LUTs used for computing ECC/EDC */
 static uint8_t eccFLut[256];
 static uint8_t eccBLut[256];
-static uint32_t edcLut[256];
+static uint32_t edcLut[8][256]; /**< edcLut[0] is the bytewise table, edcLut[k] advances a byte k positions further (slice-by-8) */
+static uint16_t eccQIndex[43][26]; /**< Q parity: source word index of each (minor, major pair), the diagonals wrap around */
 static bool tablesInit = false;
 
 static void eccedcInit() {
@@ -29,39 +31,80 @@ static void eccedcInit() {
     for( j = 0; j < 8; j++ ) {
       edc = (edc >> 1U) ^ ((edc & 1U) != 0u ? 0xD8018001 : 0);
     }
-    edcLut[i] = edc;
+    edcLut[0][i] = edc;
+  }
+  for( i = 0; i < 256; i++ ) {
+    for( j = 1; j < 8; j++ ) {
+      edcLut[j][i] = (edcLut[j - 1][i] >> 8U) ^ edcLut[0][edcLut[j - 1][i] & 0xFFU];
+    }
+  }
+  for( i = 0; i < 43; i++ ) {
+    for( j = 0; j < 26; j++ ) {
+      eccQIndex[i][j] = (j * 43 + i * 44) % 1118;
+    }
   }
   tablesInit = true;
 }
 
-static void eccCompute(const uint8_t *src, uint32_t majorCount, uint32_t minorCount, uint32_t majorMult, uint32_t minorInc, uint8_t *dest) {
-  uint32_t size = majorCount * minorCount;
-  uint32_t major = 0;
-  uint32_t minor = 0;
-  for( major = 0; major < majorCount; major++ ) {
-    uint32_t index = (major >> 1U) * majorMult + (major & 1U);
-    uint8_t eccA = 0;
-    uint8_t eccB = 0;
-    for( minor = 0; minor < minorCount; minor++ ) {
-      uint8_t temp = src[index];
-      index += minorInc;
-      if( index >= size ) {
-        index -= size;
-      }
-      eccA ^= temp;
-      eccB ^= temp;
-      eccA = eccFLut[eccA];
+/**
+ * Multiplies @ref x by 2 in GF(2^8) (polynomial 0x11D), same as eccFLut[] but without a lookup.
+ */
+static inline auto eccMul2(const uint8_t x) -> uint8_t {
+  return static_cast<uint8_t>((x << 1U) ^ ((x >> 7U) * 0x1DU));
+}
+
+/**
+ * Computes @ref majorCount parity pairs over the rows of @ref rows (@ref minorCount rows of @ref majorCount bytes each)
+ * and stores them to @ref dest. All columns are updated together so the compiler can vectorize the inner loops.
+ */
+static void eccCompute(const uint8_t *rows, uint32_t majorCount, uint32_t minorCount, uint8_t *dest) {
+  uint8_t eccA[86] = {0};
+  uint8_t eccB[86] = {0};
+  for( uint32_t minor = 0; minor < minorCount; minor++ ) {
+    const uint8_t *row = rows + minor * majorCount;
+    for( uint32_t major = 0; major < majorCount; major++ ) {
+      eccA[major] = eccMul2(eccA[major] ^ row[major]);
+      eccB[major] ^= row[major];
     }
-    eccA = eccBLut[eccFLut[eccA] ^ eccB];
-    dest[major] = eccA;
-    dest[major + majorCount] = eccA ^ eccB;
   }
+  for( uint32_t major = 0; major < majorCount; major++ ) {
+    const uint8_t a = eccBLut[eccFLut[eccA[major]] ^ eccB[major]];
+    dest[major] = a;
+    dest[major + majorCount] = a ^ eccB[major];
+  }
+}
+
+/**
+ * Computes the P and Q parities of a Mode1 / Mode2 Form1 sector (header and data must be in place).
+ * The P vectors are the columns of the data (24 rows of 86 bytes), the Q vectors are its diagonals: these are
+ * gathered into rows first.
+ * @param sector the 2352-byte sector
+ */
+static void eccComputePQ(uint8_t *sector) {
+  uint8_t *src = sector + 12;
+  eccCompute(src, 86, 24, sector + 2076);
+  uint8_t q[43 * 52];
+  for( uint32_t minor = 0; minor < 43; minor++ ) {
+    uint8_t *row = q + minor * 52;
+    for( uint32_t k = 0; k < 26; k++ ) {
+      const uint32_t index = eccQIndex[minor][k] * 2;
+      row[k * 2] = src[index];
+      row[k * 2 + 1] = src[index + 1];
+    }
+  }
+  eccCompute(q, 52, 43, sector + 2248);
 }
 
 static auto edcCompute(const uint8_t *src, int size) -> uint32_t {
   uint32_t edc = 0;
+  for( ; size >= 8; size -= 8, src += 8 ) {
+    edc ^= static_cast<uint32_t>(src[0]) | static_cast<uint32_t>(src[1]) << 8U | static_cast<uint32_t>(src[2]) << 16U |
+           static_cast<uint32_t>(src[3]) << 24U;
+    edc = edcLut[7][edc & 0xFFU] ^ edcLut[6][(edc >> 8U) & 0xFFU] ^ edcLut[5][(edc >> 16U) & 0xFFU] ^ edcLut[4][edc >> 24U] ^
+          edcLut[3][src[4]] ^ edcLut[2][src[5]] ^ edcLut[1][src[6]] ^ edcLut[0][src[7]];
+  }
   while((size--) != 0 ) {
-    edc = (edc >> 8U) ^ edcLut[(edc ^ (*src++)) & 0xFFU];
+    edc = (edc >> 8U) ^ edcLut[0][(edc ^ (*src++)) & 0xFFU];
   }
   return edc;
 }
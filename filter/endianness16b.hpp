@@ -1,21 +1,31 @@
 #ifndef PAQ8PX_ENDIANNESS16B_HPP
 #define PAQ8PX_ENDIANNESS16B_HPP
 
+#include "../Array.hpp"
 #include "../Encoder.hpp"
 #include "../file/File.hpp"
 #include "Filter.hpp"
 #include <cstdint>
 
 class EndiannessFilter : public Filter {
+private:
+    static constexpr uint32_t bufferSize = 1U << 16U;
 public:
     void encode(File *in, File *out, uint64_t size, int  /*info*/, int & /*headerSize*/) override {
-      for( uint64_t i = 0, l = size >> 1U; i < l; i++ ) {
-        uint8_t b = in->getchar();
-        out->putChar(in->getchar());
-        out->putChar(b);
-      }
-      if((size & 1U) > 0 ) {
-        out->putChar(in->getchar());
+      Array<uint8_t> buf(bufferSize);
+      for( uint64_t offset = 0; offset < size; ) {
+        const auto n = static_cast<uint32_t>(in->blockRead(&buf[0], min(static_cast<uint64_t>(bufferSize), size - offset)));
+        if( n == 0 ) {
+          break;
+        }
+        offset += n;
+        uint8_t *p = &buf[0];
+        for( uint32_t i = 0, l = n >> 1U; i < l; i++, p += 2 ) {
+          const uint8_t b = p[0];
+          p[0] = p[1];
+          p[1] = b;
+        }
+        out->blockWrite(&buf[0], n); // an odd last byte is kept as is (bufferSize is even)
       }
     }
 
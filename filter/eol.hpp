@@ -1,38 +1,62 @@
 #ifndef PAQ8PX_EOL_HPP
 #define PAQ8PX_EOL_HPP
 
+#include "../Array.hpp"
 #include "../file/File.hpp"
 #include "../Encoder.hpp"
 #include "Filter.hpp"
 #include <cstdint>
+#include <cstring>
 
 /**
  * End of line transform
  */
 class EolFilter : public Filter {
+private:
+    static constexpr uint32_t bufferSize = 1U << 16U;
 public:
     void encode(File *in, File *out, uint64_t size, int /*info*/, int & /*headerSize*/) override {
-      uint8_t b = 0;
-      uint8_t pB = 0;
-      for( int i = 0; i < static_cast<int>(size); i++ ) {
-        b = in->getchar();
-        if( pB == CARRIAGE_RETURN && b != NEW_LINE ) {
-          out->putChar(pB);
+      Array<uint8_t> inBuf(bufferSize);
+      Array<uint8_t> outBuf(bufferSize + 1);
+      bool pendingCR = false; // the previous block ended with a CR
+      for( uint64_t offset = 0; offset < size; ) {
+        const auto n = static_cast<uint32_t>(in->blockRead(&inBuf[0], min(static_cast<uint64_t>(bufferSize), size - offset)));
+        if( n == 0 ) {
+          break;
         }
-        if( b != CARRIAGE_RETURN ) {
-          out->putChar(b);
+        offset += n;
+        uint32_t k = 0;
+        if( pendingCR && inBuf[0] != NEW_LINE ) {
+          outBuf[k++] = CARRIAGE_RETURN;
+        }
+        pendingCR = false;
+        // copy the runs between CRs, drop the CRs that are followed by a LF
+        for( uint32_t i = 0; i < n; ) {
+          const auto *cr = static_cast<const uint8_t *>(memchr(&inBuf[i], CARRIAGE_RETURN, n - i));
+          const uint32_t end = cr == nullptr ? n : static_cast<uint32_t>(cr - &inBuf[0]);
+          memcpy(&outBuf[k], &inBuf[i], end - i);
+          k += end - i;
+          if( end == n ) {
+            break;
+          }
+          if( end + 1 == n ) {
+            pendingCR = true;
+          } else if( inBuf[end + 1] != NEW_LINE ) {
+            outBuf[k++] = CARRIAGE_RETURN;
+          }
+          i = end + 1;
         }
-        pB = b;
+        out->blockWrite(&outBuf[0], k);
       }
-      if( b == CARRIAGE_RETURN ) {
-        out->putChar(b);
+      if( pendingCR ) {
+        out->putChar(CARRIAGE_RETURN);
       }
     }
 
     auto decode(File * /*in*/, File *out, FMode fMode, uint64_t size, uint64_t &diffFound) -> uint64_t override {
       uint8_t b = 0;
       uint64_t count = 0;
-      for( int i = 0; i < static_cast<int>(size); i++, count++ ) {
+      for( uint64_t i = 0; i < size; i++, count++ ) {
         if((b = encoder->decompress()) == NEW_LINE ) {
           if( fMode == FDECOMPRESS ) {
             out->putChar(CARRIAGE_RETURN);
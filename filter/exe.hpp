@@ -23,11 +23,10 @@ private:
     constexpr static int block = 0x10000; /**< block size */
 public:
     /**
-     * @todo Large file support
      * @param in
      * @param out
      * @param size
-     * @param info
+     * @param info the position of the block in the file (the base of the absolute addresses, modulo 2^32)
      */
     void encode(File *in, File *out, uint64_t size, int info, int &headerSize) override {
       Array<uint8_t> blk(block);
@@ -57,7 +56,6 @@ public:
     }
 
     /**
-     * @todo Large file support
      * @param in
      * @param out
      * @param fMode
@@ -67,7 +65,7 @@ public:
      */
     uint64_t decode(File *in, File *out, FMode fMode, uint64_t size, uint64_t &diffFound) override {
       int begin = 0;
-      int offset = 6;
+      uint64_t offset = 6;
       int a = 0;
       uint8_t c[6];
       begin = static_cast<int>(encoder->decodeBlockSize());
@@ -76,15 +74,15 @@ public:
         c[i] = encoder->decompress(); // Fill queue
       }
 
-      while( offset < static_cast<int>(size) + 6 ) {
+      while( offset < size + 6 ) {
         memmove(c + 1, c, 5);
-        if( offset <= static_cast<int>(size)) {
+        if( offset <= size ) {
           c[0] = encoder->decompress();
         }
         // E8E9 transform: E8/E9 xx xx xx 00/FF -> subtract location from x
         if((c[0] == 0x00 || c[0] == 0xFF) && (c[4] == 0xE8 || c[4] == 0xE9 || (c[5] == 0x0F && (c[4] & 0xF0U) == 0x80)) &&
-           (((offset - 1) ^ (offset - 6)) & -block) == 0 && offset <= static_cast<int>(size)) { // not crossing block boundary
-          a = ((c[1] ^ 176U) | (c[2] ^ 176U) << 8 | (c[3] ^ 176U) << 16U | c[0] << 24U) - offset - begin;
+           (((offset - 1) ^ (offset - 6)) & -block) == 0 && offset <= size ) { // not crossing block boundary
+          a = ((c[1] ^ 176U) | (c[2] ^ 176U) << 8 | (c[3] ^ 176U) << 16U | c[0] << 24U) - static_cast<int>(offset) - begin;
           a <<= 7U;
           a >>= 7U;
           c[3] = a;
@@ -3,33 +3,11 @@
 
 #include "../Array.hpp"
 #include "Filter.hpp"
+#include "LZWHashTable.hpp"
 #include <cstdint>
 
 
-#define LZW_TABLE_SIZE 9221
-
-#define LZW_FIND(k) \
-  { \
-    offset     = ( int ) finalize64((k) * PHI64, 13); \
-    int stride = (offset > 0) ? LZW_TABLE_SIZE - offset : 1; \
-    while (true) { \
-      if ((index = table[offset]) < 0) { \
-        index = -offset - 1; \
-        break; \
-      } else if (dict[index] == int(k)) { \
-        break; \
-      } \
-      offset -= stride; \
-      if (offset < 0) \
-        offset += LZW_TABLE_SIZE; \
-    } \
-  }
-
-#define LZW_RESET \
-  { \
-    for (int i = 0; i < LZW_TABLE_SIZE; table[i] = -1, i++) \
-      ; \
-  }
+static constexpr uint32_t GIF_BUFFER_SIZE = 1U << 16U;
 
 static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int {
   int codeSize = in->getchar();
@@ -37,7 +15,6 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
   int clearPos = 0;
   int bsize = 0;
   int code = 0;
-  int offset = 0;
   uint64_t beginIn = in->curPos();
   uint64_t beginOut = out->curPos();
   Array<uint8_t> output(4096);
@@ -48,7 +25,13 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
   out->putChar(clearPos >> 8U);
   out->putChar(clearPos & 255U);
   out->putChar(codeSize);
-  Array<int> table(LZW_TABLE_SIZE);
+  LZWHashTable<13> table;
+  Array<uint8_t> block(255);
+  Array<int> dict(4096);
+  Array<int> first(4096); // first byte and length of the string of each code (phase 0)
+  Array<int> length(4096);
+  Array<uint8_t> outBuf(GIF_BUFFER_SIZE);
+  uint32_t outPos = 0;
   for( int phase = 0; phase < 2; phase++ ) {
     in->setpos(beginIn);
     int bits = codeSize + 1;
@@ -57,12 +40,12 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
     int blockSize = 0;
     int maxcode = (1U << codeSize) + 1;
     int last = -1;
-    Array<int> dict(4096);
-    LZW_RESET
+    table.reset();
     bool end = false;
     while((blockSize = in->getchar()) > 0 && in->curPos() - beginIn < len && !end ) {
+      const auto got = static_cast<int>(in->blockRead(&block[0], blockSize));
       for( int i = 0; i < blockSize; i++ ) {
-        buffer |= in->getchar() << shift;
+        buffer |= (i < got ? block[i] : EOF) << shift;
         shift += 8;
         while( shift >= bits && !end ) {
           code = buffer & ((1U << bits) - 1);
@@ -83,7 +66,7 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
               clearPos = 69631 - maxcode;
             }
             bits = codeSize + 1, maxcode = (1U << codeSize) + 1, last = -1;
-            LZW_RESET
+            table.reset();
           } else if( code == (1U << codeSize) + 1 ) {
             end = true;
           } else if( code > maxcode + 1 ) {
@@ -91,21 +74,26 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
           } else {
             int j = (code <= maxcode ? code : last);
             int size = 1;
-            while( j >= (1U << codeSize)) {
-              output[4096 - (size++)] = dict[j] & 255U;
-              j = dict[j] >> 8U;
-            }
-            output[4096 - size] = j;
-            if( phase == 1 ) {
-              out->blockWrite(&output[4096 - size], size);
+            if( phase == 0 ) { // only the positions are needed: no need to expand the string
+              if( j >= (1 << codeSize)) {
+                size = length[j];
+                j = first[j];
+              }
+              diffPos += size + static_cast<int>(code == maxcode + 1);
             } else {
-              diffPos += size;
-            }
-            if( code == maxcode + 1 ) {
-              if( phase == 1 ) {
-                out->putChar(j);
-              } else {
-                diffPos++;
+              while( j >= (1U << codeSize)) {
+                output[4096 - (size++)] = dict[j] & 255U;
+                j = dict[j] >> 8U;
+              }
+              output[4096 - size] = j;
+              if( outPos + size + 1 > GIF_BUFFER_SIZE ) {
+                out->blockWrite(&outBuf[0], outPos);
+                outPos = 0;
+              }
+              memcpy(&outBuf[outPos], &output[4096 - size], size);
+              outPos += size;
+              if( code == maxcode + 1 ) {
+                outBuf[outPos++] = j;
               }
             }
             if( last != -1 ) {
@@ -114,15 +102,20 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
               }
               if( maxcode <= 4095 ) {
                 int key = (last << 8U) + j;
-                int index = -1;
-                LZW_FIND(key)
-                dict[maxcode] = key;
-                table[(index < 0) ? -index - 1 : offset] = maxcode;
-                if( phase == 0 && index > 0 ) {
-                  headerSize += 4;
-                  j = diffPos - size - static_cast<int>(code == maxcode);
-                  out->put32(j);
-                  diffPos = size + static_cast<int>(code == maxcode);
+                if( phase == 1 ) {
+                  dict[maxcode] = key;
+                } else {
+                  uint32_t slot = 0;
+                  const int index = table.find(key, slot);
+                  table.set(slot, key, maxcode);
+                  first[maxcode] = last >= (1 << codeSize) ? first[last] : last;
+                  length[maxcode] = (last >= (1 << codeSize) ? length[last] : 1) + 1;
+                  if( index > 0 ) {
+                    headerSize += 4;
+                    j = diffPos - size - static_cast<int>(code == maxcode);
+                    out->put32(j);
+                    diffPos = size + static_cast<int>(code == maxcode);
+                  }
                 }
               }
               if( maxcode >= ((1U << bits) - 1) && bits < 12 ) {
@@ -135,6 +128,7 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
       }
     }
   }
+  out->blockWrite(&outBuf[0], outPos);
   diffPos = static_cast<int>(out->curPos());
   out->setpos(beginOut);
   out->putChar(headerSize >> 8U);
@@ -151,12 +145,14 @@ static auto encodeGif(File *in, File *out, uint64_t len, int &headerSize) -> int
     output[0] = (count); \
     if (mode == FDECOMPRESS) \
       out->blockWrite(&output[0], (count) + 1); \
-    else if (mode == FCOMPARE) \
+    else if (mode == FCOMPARE) { \
+      const int got = static_cast<int>(out->blockRead(&cmp[0], (count) + 1)); \
       for (int j = 0; j < (count) + 1; j++) \
-        if (output[j] != out->getchar() && ! diffFound) { \
+        if ((j >= got || output[j] != cmp[j]) && ! diffFound) { \
           diffFound = outsize + j + 1; \
           return 1; \
         } \
+    } \
     outsize += (count) + 1; \
     blockSize = 0; \
   }
@@ -193,10 +189,7 @@ static auto decodeGif(File *in, uint64_t size, File *out, FMode mode, uint64_t &
   int maxcode = (1U << codesize) + 1;
   int input = 0;
   int code = 0;
-  int offset = 0;
-  Array<int> dict(4096);
-  Array<int> table(LZW_TABLE_SIZE);
-  LZW_RESET
+  LZWHashTable<13> table;
   for( int i = 0; i < diffCount; i++ ) {
     diffPos[i] = in->getchar();
     diffPos[i] = (diffPos[i] << 8) + in->getchar();
@@ -207,8 +200,22 @@ static auto decodeGif(File *in, uint64_t size, File *out, FMode mode, uint64_t &
     }
   }
   Array<uint8_t> output(256);
+  Array<uint8_t> cmp(256);
+  Array<uint8_t> inBuf(GIF_BUFFER_SIZE);
+  uint32_t inPos = 0;
+  uint32_t inLen = 0;
+  auto getByte = [&]() -> int {
+    if( inPos == inLen ) {
+      inLen = static_cast<uint32_t>(in->blockRead(&inBuf[0], min(static_cast<uint64_t>(GIF_BUFFER_SIZE), size)));
+      inPos = 0;
+      if( inLen == 0 ) {
+        return EOF;
+      }
+    }
+    return inBuf[inPos++];
+  };
   size -= 6 + diffCount * 4;
-  int last = in->getchar();
+  int last = getByte();
   int total = static_cast<int>(size) + 1;
   int outsize = 1;
   if( mode == FDECOMPRESS ) {
@@ -221,13 +228,11 @@ static auto decodeGif(File *in, uint64_t size, File *out, FMode mode, uint64_t &
   if( diffCount == 0 || diffPos[0] != 0 ) GIF_WRITE_CODE(1U << codesize) else {
     curDiff++;
   }
-  while( size != 0 && (input = in->getchar()) != EOF) {
+  while( size != 0 && (input = getByte()) != EOF) {
     size--;
     int key = (last << 8U) + input;
-    int index = (code = -1);
-    if( last < 0 ) {
-      index = input;
-    } else LZW_FIND(key)
+    uint32_t slot = 0;
+    int index = (last < 0) ? input : table.find(key, slot);
     code = index;
     if( curDiff < diffCount && total - static_cast<int>(size) > diffPos[curDiff] ) {
       curDiff++, code = -1;
@@ -237,12 +242,11 @@ static auto decodeGif(File *in, uint64_t size, File *out, FMode mode, uint64_t &
       if( maxcode == clearPos ) {
         GIF_WRITE_CODE(1U << codesize)
         bits = codesize + 1, maxcode = (1U << codesize) + 1;
-        LZW_RESET
+        table.reset();
       } else {
         ++maxcode;
         if( maxcode <= 4095 ) {
-          dict[maxcode] = key;
-          table[(index < 0) ? -index - 1 : offset] = maxcode;
+          table.set(slot, key, maxcode);
         }
         if( maxcode >= (1U << bits) && bits < 12 ) {
           bits++;
@@ -1,6 +1,7 @@
 #ifndef PAQ8PX_IM32_HPP
 #define PAQ8PX_IM32_HPP
 
+#include "../Array.hpp"
 #include "../Encoder.hpp"
 #include "../file/File.hpp"
 #include "Filter.hpp"
@@ -8,28 +9,32 @@
 
 // 32-bit image
 static void encodeIm32(File *in, File *out, uint64_t len, int width) {
+  constexpr uint32_t bufferSize = 1U << 16U; // the image is transformed in blocks of whole rows of about this size
   Shared *shared = Shared::getInstance();
-  int r = 0;
-  int g = 0;
-  int b = 0;
-  int a = 0;
-  for( int i = 0; i < static_cast<int>(len / width); i++ ) {
-    for( int j = 0; j < width / 4; j++ ) {
-      b = in->getchar();
-      g = in->getchar();
-      r = in->getchar();
-      a = in->getchar();
-      out->putChar(g);
-      out->putChar((shared->options & OPTION_SKIPRGB) != 0u ? r : g - r);
-      out->putChar((shared->options & OPTION_SKIPRGB) != 0u ? b : g - b);
-      out->putChar(a);
-    }
-    for( int j = 0; j < width % 4; j++ ) {
-      out->putChar(in->getchar());
+  const bool skipRgb = (shared->options & OPTION_SKIPRGB) != 0u;
+  const int rows = static_cast<int>(len / width);
+  const int rowsPerBlock = max(1, static_cast<int>(bufferSize / width));
+  Array<uint8_t> blk(static_cast<uint64_t>(rowsPerBlock) * width);
+  for( int i = 0; i < rows; i += rowsPerBlock ) {
+    const uint64_t blkSize = static_cast<uint64_t>(min(rowsPerBlock, rows - i)) * width;
+    in->blockRead(&blk[0], blkSize);
+    for( uint64_t row = 0; row < blkSize; row += width ) {
+      uint8_t *pixel = &blk[row];
+      for( int j = 0; j < width / 4; j++, pixel += 4 ) {
+        const uint8_t b = pixel[0];
+        const uint8_t g = pixel[1];
+        const uint8_t r = pixel[2];
+        pixel[0] = g;
+        pixel[1] = skipRgb ? r : g - r;
+        pixel[2] = skipRgb ? b : g - b;
+      }
     }
+    out->blockWrite(&blk[0], blkSize);
   }
-  for( int i = len % width; i > 0; i-- ) {
-    out->putChar(in->getchar());
+  const auto tail = static_cast<uint32_t>(len % width);
+  if( tail > 0 ) {
+    in->blockRead(&blk[0], tail);
+    out->blockWrite(&blk[0], tail);
   }
 }
 
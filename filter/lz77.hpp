@@ -0,0 +1,288 @@
+#ifndef PAQ8PX_LZ77_HPP
+#define PAQ8PX_LZ77_HPP
+
+#include "../Array.hpp"
+#include "../Shared.hpp"
+#include "../VLI.hpp"
+#include "../file/File.hpp"
+#include "Filter.hpp"
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Long-range match transform (srep-style LZ77 pre-pass).
+ *
+ * Finds long repeats at any distance in the whole block (which may be much larger than the ring buffer of the models)
+ * and replaces them with copy tokens before context modeling.
+ * The encoder indexes the hash of every BLOCK_SIZE-aligned block of the input in a sparse hash table and looks up the rolling
+ * hash of the last BLOCK_SIZE bytes at every position. Candidate matches are verified and extended in both directions.
+ * Any repeat of at least MIN_MATCH (= 2 * BLOCK_SIZE) bytes is guaranteed to contain an aligned block, thus it is found.
+ *
+ * Transformed format:
+ *   <number of matches> { <literal length> <match length> <distance> } <literals>
+ * All numbers are VLI encoded. The literals are the input bytes not covered by any match, in their original order.
+ */
+class Lz77Filter : public Filter {
+public:
+    static constexpr uint32_t BLOCK_SIZE = 256;
+    static constexpr uint32_t MIN_MATCH = BLOCK_SIZE * 2;
+
+private:
+    static constexpr uint64_t MULTIPLIER = UINT64_C(0x9E3779B97F4A7C15); /**< for the rolling hash */
+    static constexpr uint64_t HASH_MULTIPLIER = UINT64_C(0xD39104E950564B37); /**< for the hash table index */
+    static constexpr uint32_t IO_SIZE = 1U << 16U;
+
+    struct Match {
+        uint64_t literalLength; /**< number of literals preceding the match */
+        uint64_t length;
+        uint64_t distance;
+    };
+
+    /**
+     * Returns the number of equal bytes at positions @ref a and @ref b (a < b) of @ref in, but at most @ref maxLength.
+     */
+    static auto matchForward(File *in, const uint64_t a, const uint64_t b, const uint64_t maxLength) -> uint64_t {
+      Array<uint8_t> bufA(IO_SIZE);
+      Array<uint8_t> bufB(IO_SIZE);
+      uint64_t length = 0;
+      while( length < maxLength ) {
+        const auto n = static_cast<uint32_t>(min(static_cast<uint64_t>(IO_SIZE), maxLength - length));
+        in->setpos(a + length);
+        const auto nA = static_cast<uint32_t>(in->blockRead(&bufA[0], n));
+        in->setpos(b + length);
+        const auto nB = static_cast<uint32_t>(in->blockRead(&bufB[0], n));
+        const uint32_t m = nA < nB ? nA : nB;
+        uint32_t i = 0;
+        while( i < m && bufA[i] == bufB[i] ) {
+          i++;
+        }
+        length += i;
+        if( i < n ) {
+          break;
+        }
+      }
+      return length;
+    }
+
+    /**
+     * Returns the number of equal bytes preceding positions @ref a and @ref b (a < b) of @ref in, but at most @ref maxLength.
+     */
+    static auto matchBackward(File *in, const uint64_t a, const uint64_t b, const uint32_t maxLength) -> uint32_t {
+      if( maxLength == 0 ) {
+        return 0;
+      }
+      uint8_t bufA[BLOCK_SIZE];
+      uint8_t bufB[BLOCK_SIZE];
+      in->setpos(a - maxLength);
+      in->blockRead(&bufA[0], maxLength);
+      in->setpos(b - maxLength);
+      in->blockRead(&bufB[0], maxLength);
+      uint32_t length = 0;
+      while( length < maxLength && bufA[maxLength - 1 - length] == bufB[maxLength - 1 - length] ) {
+        length++;
+      }
+      return length;
+    }
+
+    /**
+     * Writes (FDECOMPRESS) or compares (FCOMPARE) @ref n bytes of @ref data at the current position of @ref out.
+     * @return false if a difference is found
+     */
+    static auto emit(File *out, uint8_t *data, const uint32_t n, const FMode fMode, const uint64_t outPos, uint64_t &diffFound) -> bool {
+      if( fMode == FDECOMPRESS ) {
+        out->blockWrite(data, n);
+      } else if( fMode == FCOMPARE ) {
+        for( uint32_t i = 0; i < n; i++ ) {
+          if( out->getchar() != data[i] ) {
+            diffFound = outPos + i + 1;
+            return false;
+          }
+        }
+      }
+      return true;
+    }
+
+public:
+    void encode(File *in, File *out, uint64_t size, int /*info*/, int &headerSize) override {
+      Shared *shared = Shared::getInstance();
+      const uint64_t start = in->curPos();
+
+      // the table holds (upper 32 bits of the hash, block number + 1) for each indexed block
+      int tableBits = 20;
+      while((1ULL << tableBits) < size / BLOCK_SIZE && (sizeof(uint64_t) << tableBits) < shared->mem * 2 ) {
+        tableBits++;
+      }
+      Array<uint64_t> table(1ULL << tableBits);
+
+      uint64_t multiplierPow = 1; // MULTIPLIER^(BLOCK_SIZE-1): the weight of the byte leaving the window
+      for( uint32_t i = 1; i < BLOCK_SIZE; i++ ) {
+        multiplierPow *= MULTIPLIER;
+      }
+
+      Array<Match> matches(0);
+      Array<uint8_t> buf(IO_SIZE);
+      uint64_t bufStart = 0;
+      uint64_t bufLength = 0;
+      uint8_t window[BLOCK_SIZE];
+      uint64_t h = 0; // rolling hash of the last BLOCK_SIZE bytes
+      uint32_t filled = 0; // number of valid bytes in the window
+      uint64_t literalStart = 0;
+      uint64_t pos = 0;
+
+      while( pos < size ) {
+        if( pos < bufStart || pos >= bufStart + bufLength ) {
+          in->setpos(start + pos);
+          bufStart = pos;
+          bufLength = in->blockRead(&buf[0], min(static_cast<uint64_t>(IO_SIZE), size - pos));
+          if( bufLength == 0 ) {
+            break;
+          }
+        }
+        const uint8_t c = buf[pos - bufStart];
+        const uint32_t windowPos = pos % BLOCK_SIZE;
+        if( filled >= BLOCK_SIZE ) {
+          h -= window[windowPos] * multiplierPow;
+        } else {
+          filled++;
+        }
+        h = h * MULTIPLIER + c;
+        window[windowPos] = c;
+        pos++;
+        if( filled < BLOCK_SIZE ) {
+          continue;
+        }
+
+        // the window is [pos - BLOCK_SIZE, pos)
+        const uint64_t slot = (h * HASH_MULTIPLIER) >> (64 - tableBits);
+        const uint64_t entry = table[slot];
+        const auto blockNumber = static_cast<uint32_t>(entry);
+        const uint64_t cur = pos - BLOCK_SIZE;
+        if( blockNumber != 0 && (entry >> 32U) == (h >> 32U)) {
+          const uint64_t src = (blockNumber - 1) * static_cast<uint64_t>(BLOCK_SIZE);
+          // copies must not overlap: the source must end before the destination begins
+          const uint64_t maxForward = min(size - cur, cur - src);
+          const uint64_t forward = maxForward >= BLOCK_SIZE ? matchForward(in, start + src, start + cur, maxForward) : 0;
+          if( forward >= BLOCK_SIZE ) {
+            const uint64_t backLimit = min(min(static_cast<uint64_t>(BLOCK_SIZE - 1), cur - literalStart), src);
+            const uint32_t backward = matchBackward(in, start + src, start + cur, static_cast<uint32_t>(backLimit));
+            uint64_t length = forward + backward;
+            if( length > cur - src ) {
+              length = cur - src;
+            }
+            if( length >= MIN_MATCH ) {
+              const uint64_t matchStart = cur - backward;
+              matches.pushBack({matchStart - literalStart, length, cur - src});
+              pos = literalStart = matchStart + length;
+              filled = 0;
+              h = 0;
+              continue;
+            }
+          }
+        }
+        if( pos % BLOCK_SIZE == 0 ) {
+          table[slot] = (h >> 32U) << 32U | (pos / BLOCK_SIZE);
+        }
+      }
+
+      out->putVLI(matches.size());
+      headerSize = VLICost(matches.size());
+      for( uint64_t i = 0; i < matches.size(); i++ ) {
+        out->putVLI(matches[i].literalLength);
+        out->putVLI(matches[i].length);
+        out->putVLI(matches[i].distance);
+        headerSize += VLICost(matches[i].literalLength) + VLICost(matches[i].length) + VLICost(matches[i].distance);
+      }
+      // copy literals
+      uint64_t srcPos = 0;
+      for( uint64_t i = 0; i <= matches.size(); i++ ) {
+        uint64_t n = i < matches.size() ? matches[i].literalLength : size - srcPos;
+        in->setpos(start + srcPos);
+        srcPos += n + (i < matches.size() ? matches[i].length : 0);
+        while( n > 0 ) {
+          const auto k = static_cast<uint32_t>(in->blockRead(&buf[0], min(static_cast<uint64_t>(IO_SIZE), n)));
+          if( k == 0 ) {
+            break;
+          }
+          out->blockWrite(&buf[0], k);
+          n -= k;
+        }
+      }
+      in->setpos(start + size);
+    }
+
+    auto decode(File *in, File *out, FMode fMode, uint64_t size, uint64_t &diffFound) -> uint64_t override {
+      const uint64_t numMatches = in->getVLI();
+      Array<Match> matches(numMatches);
+      uint64_t totalLiterals = 0;
+      for( uint64_t i = 0; i < numMatches; i++ ) {
+        matches[i].literalLength = in->getVLI();
+        matches[i].length = in->getVLI();
+        matches[i].distance = in->getVLI();
+        totalLiterals += matches[i].literalLength;
+      }
+      const uint64_t headerEnd = in->curPos();
+      if( headerEnd + totalLiterals > size ) {
+        if( fMode == FDECOMPRESS ) {
+          quit("Unexpected LZ77 decoding state");
+        }
+        diffFound = 1;
+        return 0;
+      }
+      const uint64_t lastLiterals = size - headerEnd - totalLiterals;
+
+      Array<uint8_t> buf(IO_SIZE);
+      const uint64_t base = out->curPos();
+      uint64_t outPos = 0;
+      for( uint64_t i = 0; i <= numMatches; i++ ) {
+        // literals
+        uint64_t n = i < numMatches ? matches[i].literalLength : lastLiterals;
+        while( n > 0 ) {
+          const auto k = static_cast<uint32_t>(in->blockRead(&buf[0], min(static_cast<uint64_t>(IO_SIZE), n)));
+          if( k == 0 ) {
+            if( fMode == FDECOMPRESS ) {
+              quit("Unexpected LZ77 decoding state");
+            }
+            diffFound = outPos + 1;
+            return outPos;
+          }
+          if( !emit(out, &buf[0], k, fMode, outPos, diffFound)) {
+            return outPos;
+          }
+          outPos += k;
+          n -= k;
+        }
+        if( i == numMatches ) {
+          break;
+        }
+        // copy from the already restored output
+        const Match &match = matches[i];
+        if( match.distance == 0 || match.distance > outPos || match.length > match.distance ) {
+          if( fMode == FDECOMPRESS ) {
+            quit("Unexpected LZ77 decoding state");
+          }
+          diffFound = outPos + 1;
+          return outPos;
+        }
+        for( uint64_t done = 0; done < match.length; ) {
+          const auto k = static_cast<uint32_t>(min(static_cast<uint64_t>(IO_SIZE), match.length - done));
+          out->setpos(base + outPos - match.distance);
+          if( out->blockRead(&buf[0], k) != k ) {
+            if( fMode == FDECOMPRESS ) {
+              quit("Unexpected LZ77 decoding state");
+            }
+            diffFound = outPos + 1;
+            return outPos;
+          }
+          out->setpos(base + outPos);
+          if( !emit(out, &buf[0], k, fMode, outPos, diffFound)) {
+            return outPos;
+          }
+          outPos += k;
+          done += k;
+        }
+      }
+      return outPos;
+    }
+};
+
+#endif //PAQ8PX_LZ77_HPP
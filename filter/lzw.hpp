@@ -8,173 +8,171 @@
 
 #include "LZWDictionary.hpp"
 
-class LZWFilter : Filter {
-public:
-    void encode(File *in, File *out, uint64_t  /*size*/, int  /*info*/, int & /*headerSize*/) override {
-      LZWDictionary dic;
-      int parent = -1;
-      int code = 0;
-      int buffer = 0;
-      int bitsPerCode = 9;
-      int bitsUsed = 0;
-      bool done = false;
-      while( !done ) {
-        buffer = in->getchar();
-        if( buffer < 0 ) {
-          return;// 0;
+static constexpr uint32_t LZW_BUFFER_SIZE = 1U << 16U;
+
+static auto encodeLzw(File *in, File *out, uint64_t /*size*/, int & /*headerSize*/) -> int {
+  LZWDictionary dic;
+  Array<uint8_t> buf(LZW_BUFFER_SIZE);
+  uint32_t bufPos = 0;
+  uint32_t bufLen = 0;
+  int parent = -1;
+  uint32_t bits = 0; // unread bits of the input (MSB first)
+  int bitCount = 0;
+  int bitsPerCode = 9;
+  while( true ) {
+    while( bitCount < bitsPerCode ) {
+      if( bufPos == bufLen ) {
+        bufLen = static_cast<uint32_t>(in->blockRead(&buf[0], LZW_BUFFER_SIZE));
+        bufPos = 0;
+        if( bufLen == 0 ) {
+          return 0;
         }
-        for( int j = 0; j < 8; j++ ) {
-          code += code + ((buffer >> (7 - j)) & 1), bitsUsed++;
-          if( bitsUsed >= bitsPerCode ) {
-            if( code == LZW_EOF_CODE ) {
-              done = true;
-              break;
-            }
-            if( code == LZW_RESET_CODE ) {
-              dic.reset();
-              parent = -1;
-              bitsPerCode = 9;
-            } else {
-              if( code < dic.index ) {
-                if( parent != -1 ) {
-                  dic.addEntry(parent, dic.dumpEntry(out, code));
-                } else {
-                  out->putChar(code);
-                }
-              } else if( code == dic.index ) {
-                int a = dic.dumpEntry(out, parent);
-                out->putChar(a);
-                dic.addEntry(parent, a);
-              } else {
-                return;// 0;
-              }
-              parent = code;
-            }
-            bitsUsed = 0;
-            code = 0;
-            if((1U << bitsPerCode) == dic.index + 1 && dic.index < 4096 ) {
-              bitsPerCode++;
-            }
-          }
+      }
+      bits = (bits << 8U) | buf[bufPos++];
+      bitCount += 8;
+    }
+    bitCount -= bitsPerCode;
+    const int code = (bits >> bitCount) & ((1U << bitsPerCode) - 1);
+    if( code == LZW_EOF_CODE ) {
+      return 1;
+    }
+    if( code == LZW_RESET_CODE ) {
+      dic.reset();
+      parent = -1;
+      bitsPerCode = 9;
+    } else {
+      if( code < dic.index ) {
+        if( parent != -1 ) {
+          dic.addEntry(parent, dic.dumpEntry(out, code));
+        } else {
+          out->putChar(code);
         }
+      } else if( code == dic.index ) {
+        int a = dic.dumpEntry(out, parent);
+        out->putChar(a);
+        dic.addEntry(parent, a);
+      } else {
+        return 0;
       }
-      // return 1;
+      parent = code;
     }
-
-    auto decode(File * /*in*/, File * /*out*/, FMode  /*fMode*/, uint64_t  /*size*/, uint64_t & /*diffFound*/) -> uint64_t override {
-      return 0;
+    if((1 << bitsPerCode) == dic.index + 1 && dic.index < 4096 ) {
+      bitsPerCode++;
     }
+  }
+}
 
-};
+/**
+ * Packs LZW codes (MSB first) into bytes and writes them to (or compares them with) a file in blocks.
+ */
+class LZWCodeWriter {
+private:
+    File *f;
+    const FMode mode;
+    uint64_t &diffFound;
+    Array<uint8_t> block {LZW_BUFFER_SIZE};
+    Array<uint8_t> cmp;
+    uint32_t blockSize = 0;
+    uint64_t pos = 0; /**< number of bytes flushed */
+    uint32_t buffer = 0;
+    int bitsUsed = 0;
 
-static auto encodeLzw(File *in, File *out, uint64_t size, int &headerSize) -> int {
-  LZWDictionary dic;
-  int parent = -1;
-  int code = 0;
-  int buffer = 0;
-  int bitsPerCode = 9;
-  int bitsUsed = 0;
-  bool done = false;
-  while( !done ) {
-    buffer = in->getchar();
-    if( buffer < 0 ) {
-      return 0;
+    void putByte(const uint8_t b) {
+      block[blockSize++] = b;
+      if( blockSize == LZW_BUFFER_SIZE ) {
+        flush();
+      }
     }
-    for( int j = 0; j < 8; j++ ) {
-      code += code + ((buffer >> (7 - j)) & 1U), bitsUsed++;
-      if( bitsUsed >= bitsPerCode ) {
-        if( code == LZW_EOF_CODE ) {
-          done = true;
-          break;
-        }
-        if( code == LZW_RESET_CODE ) {
-          dic.reset();
-          parent = -1;
-          bitsPerCode = 9;
-        } else {
-          if( code < dic.index ) {
-            if( parent != -1 ) {
-              dic.addEntry(parent, dic.dumpEntry(out, code));
-            } else {
-              out->putChar(code);
-            }
-          } else if( code == dic.index ) {
-            int a = dic.dumpEntry(out, parent);
-            out->putChar(a);
-            dic.addEntry(parent, a);
-          } else {
-            return 0;
+
+    void flush() {
+      if( mode == FDECOMPRESS ) {
+        f->blockWrite(&block[0], blockSize);
+      } else if( mode == FCOMPARE && diffFound == 0 ) {
+        const auto n = static_cast<uint32_t>(f->blockRead(&cmp[0], blockSize));
+        for( uint32_t i = 0; i < blockSize; i++ ) {
+          if( i >= n || block[i] != cmp[i] ) {
+            diffFound = pos + i + 1;
+            break;
           }
-          parent = code;
-        }
-        bitsUsed = 0;
-        code = 0;
-        if((1 << bitsPerCode) == dic.index + 1 && dic.index < 4096 ) {
-          bitsPerCode++;
         }
       }
+      pos += blockSize;
+      blockSize = 0;
     }
-  }
-  return 1;
-}
 
-static inline void writeCode(File *f, const FMode mode, int *buffer, uint64_t *pos, int *bitsUsed, const int bitsPerCode, const int code,
-                             uint64_t *diffFound) {
-  *buffer <<= bitsPerCode;
-  *buffer |= code;
-  (*bitsUsed) += bitsPerCode;
-  while((*bitsUsed) > 7 ) {
-    const uint8_t b = *buffer >> (*bitsUsed -= 8);
-    (*pos)++;
-    if( mode == FDECOMPRESS ) {
-      f->putChar(b);
-    } else if( mode == FCOMPARE && b != f->getchar()) {
-      *diffFound = *pos;
+public:
+    LZWCodeWriter(File *f, const FMode mode, uint64_t &diffFound) :
+            f(f), mode(mode), diffFound(diffFound), cmp(mode == FCOMPARE ? LZW_BUFFER_SIZE : 0) {}
+
+    void write(const int code, const int bitsPerCode) {
+      buffer = (buffer << bitsPerCode) | code;
+      bitsUsed += bitsPerCode;
+      while( bitsUsed > 7 ) {
+        bitsUsed -= 8;
+        putByte(buffer >> bitsUsed);
+      }
     }
-  }
-}
+
+    /**
+     * Pads the last partial byte with zero bits and flushes.
+     * @return the number of bytes written
+     */
+    auto finish() -> uint64_t {
+      if( bitsUsed > 0 ) {
+        putByte(buffer << (8 - bitsUsed));
+        bitsUsed = 0;
+      }
+      flush();
+      return pos;
+    }
+};
 
 static auto decodeLzw(File *in, File *out, FMode mode, uint64_t &diffFound) -> uint64_t {
   LZWDictionary dic;
-  uint64_t pos = 0;
+  LZWCodeWriter writer(out, mode, diffFound);
+  Array<uint8_t> buf(LZW_BUFFER_SIZE);
   int parent = -1;
-  int code = 0;
-  int buffer = 0;
   int bitsPerCode = 9;
-  int bitsUsed = 0;
-  writeCode(out, mode, &buffer, &pos, &bitsUsed, bitsPerCode, LZW_RESET_CODE, &diffFound);
-  while((code = in->getchar()) >= 0 && diffFound == 0 ) {
-    int index = dic.findEntry(parent, code);
-    if( index < 0 ) { // entry not found
-      writeCode(out, mode, &buffer, &pos, &bitsUsed, bitsPerCode, parent, &diffFound);
-      if( dic.index > 4092 ) {
-        writeCode(out, mode, &buffer, &pos, &bitsUsed, bitsPerCode, LZW_RESET_CODE, &diffFound);
-        dic.reset();
-        bitsPerCode = 9;
-      } else {
-        dic.addEntry(parent, code, index);
-        if( dic.index >= (1U << bitsPerCode)) {
-          bitsPerCode++;
+  writer.write(LZW_RESET_CODE, bitsPerCode);
+  uint32_t bufLen = 0;
+  while( diffFound == 0 && (bufLen = static_cast<uint32_t>(in->blockRead(&buf[0], LZW_BUFFER_SIZE))) > 0 ) {
+    for( uint32_t i = 0; i < bufLen; i++ ) {
+      const int code = buf[i];
+      int index = dic.findEntry(parent, code);
+      if( index < 0 ) { // entry not found
+        writer.write(parent, bitsPerCode);
+        if( dic.index > 4092 ) {
+          writer.write(LZW_RESET_CODE, bitsPerCode);
+          dic.reset();
+          bitsPerCode = 9;
+        } else {
+          dic.addEntry(parent, code, index);
+          if( dic.index >= (1U << bitsPerCode)) {
+            bitsPerCode++;
+          }
         }
+        parent = code;
+      } else {
+        parent = index;
       }
-      parent = code;
-    } else {
-      parent = index;
     }
   }
   if( parent >= 0 ) {
-    writeCode(out, mode, &buffer, &pos, &bitsUsed, bitsPerCode, parent, &diffFound);
-  }
-  writeCode(out, mode, &buffer, &pos, &bitsUsed, bitsPerCode, LZW_EOF_CODE, &diffFound);
-  if( bitsUsed > 0 ) { // flush buffer
-    pos++;
-    if( mode == FDECOMPRESS ) {
-      out->putChar(uint8_t(buffer));
-    } else if( mode == FCOMPARE && uint8_t(buffer) != out->getchar()) {
-      diffFound = pos;
-    }
+    writer.write(parent, bitsPerCode);
   }
-  return pos;
+  writer.write(LZW_EOF_CODE, bitsPerCode);
+  return writer.finish();
 }
 
+class LZWFilter : Filter {
+public:
+    void encode(File *in, File *out, uint64_t size, int /*info*/, int &headerSize) override {
+      encodeLzw(in, out, size, headerSize);
+    }
+
+    auto decode(File *in, File *out, FMode fMode, uint64_t /*size*/, uint64_t &diffFound) -> uint64_t override {
+      return decodeLzw(in, out, fMode, diffFound);
+    }
+};
+
 #endif //PAQ8PX_LZW_HPP
@@ -2,7 +2,9 @@
 #define PAQ8PX_RLE_HPP
 
 #include "Filter.hpp"
+#include "../Array.hpp"
 #include "../VLI.hpp"
+#include <cstring>
 
 #define RLE_OUTPUT_RUN \
   { \
@@ -15,6 +17,8 @@
 
 class RleFilter : Filter {
 private:
+    static constexpr uint32_t bufferSize = 1U << 16U;
+
     enum {
         BASE, LITERAL, RUN, LITERAL_RUN
     } state = BASE;
@@ -56,30 +60,56 @@ private:
 
 public:
     void encode(File *in, File *out, uint64_t size, int info, int &headerSize) override {
+      Array<uint8_t> inBuf(bufferSize);
+      Array<uint8_t> outBuf(bufferSize);
+      uint32_t inPos = 0;
+      uint32_t inLen = 0;
+      uint32_t outPos = 0;
+      // like getchar(): packets may extend past the block, and EOF reads as 0xFF
+      auto getByte = [&]() -> uint8_t {
+        if( inPos == inLen ) {
+          inLen = static_cast<uint32_t>(in->blockRead(&inBuf[0], bufferSize));
+          inPos = 0;
+          if( inLen == 0 ) {
+            return 0xFF;
+          }
+        }
+        return inBuf[inPos++];
+      };
+      auto putBytes = [&](const uint8_t *data, uint32_t n) {
+        if( outPos + n > bufferSize ) {
+          out->blockWrite(&outBuf[0], outPos);
+          outPos = 0;
+        }
+        memcpy(&outBuf[outPos], data, n);
+        outPos += n;
+      };
+
       uint8_t b = 0;
-      uint8_t c = in->getchar();
-      int i = 1;
+      uint8_t c = getByte();
+      uint64_t i = 1;
       int maxBlockSize = info & 0xFFFFFFU;
       out->putVLI(maxBlockSize);
       headerSize = VLICost(maxBlockSize);
-      while( i < static_cast<int>(size)) {
-        b = in->getchar(), i++;
+      while( i < size ) {
+        b = getByte(), i++;
         if( c == 0x80 ) {
           c = b;
           continue;
         }
         if( c > 0x7F ) {
-          for( int j = 0; j <= (c & 0x7FU); j++ ) {
-            out->putChar(b);
-          }
-          c = in->getchar(), i++;
+          uint8_t run[128];
+          memset(run, b, (c & 0x7FU) + 1);
+          putBytes(run, (c & 0x7FU) + 1);
+          c = getByte(), i++;
         } else {
           for( int j = 0; j <= c; j++, i++ ) {
-            out->putChar(b), b = in->getchar();
+            putBytes(&b, 1), b = getByte();
           }
           c = b;
         }
       }
+      out->blockWrite(&outBuf[0], outPos);
     }
 
     auto decode(File *in, File *out, FMode fMode, uint64_t  /*size*/, uint64_t &diffFound) -> uint64_t override {
@@ -2,10 +2,21 @@
 #define PAQ8PX_ZLIB_HPP
 
 #include "Filters.hpp"
+#include "../Hash.hpp"
+#include "../file/FileTmp.hpp"
 #include "../utils.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <zlib.h>
 
 static auto parseZlibHeader(int header) -> int {
+  if((header & 0x0F00) != 0x0800 ) {
+    return -1; // not deflate: skip the switch for most of the input
+  }
   switch( header ) {
     case 0x2815:
       return 0;
@@ -60,6 +71,45 @@ static auto parseZlibHeader(int header) -> int {
   }
 }
 
+/**
+ * Quick plausibility check of a raw DEFLATE block header (for brute force detection).
+ * Returns false only when inflate() would certainly fail at the beginning of @ref data: the block type is invalid, or in a
+ * dynamic Huffman block the number of literal/length or distance codes is out of range, or the code length code is
+ * over-subscribed or incomplete. These are decided within the first 10 bytes of the block.
+ * @param data at least 12 bytes
+ * @return
+ */
+static auto isPlausibleDeflateHeader(const uint8_t *data) -> bool {
+  auto getBits = [data](const uint32_t pos, const uint32_t n) -> uint32_t {
+    const uint32_t k = pos >> 3U;
+    return ((data[k] | data[k + 1] << 8U | data[k + 2] << 16U) >> (pos & 7U)) & ((1U << n) - 1);
+  };
+  const uint32_t bType = getBits(1, 2);
+  if( bType != 2 ) {
+    return bType != 3;
+  }
+  const uint32_t hLit = getBits(3, 5);
+  const uint32_t hDist = getBits(8, 5);
+  const uint32_t hcLen = getBits(13, 4) + 4;
+  if( hLit > 29 || hDist > 29 ) {
+    return false;
+  }
+  int count[8] = {0};
+  for( uint32_t k = 0; k < hcLen; k++ ) {
+    count[getBits(17 + 3 * k, 3)]++;
+  }
+  int left = 1;
+  bool anyCode = false;
+  for( int len = 1; len < 8; len++ ) {
+    left = (left << 1) - count[len];
+    anyCode |= count[len] > 0;
+    if( left < 0 ) {
+      return false; // over-subscribed
+    }
+  }
+  return !anyCode || left == 0; // zlib accepts an empty set (it fails later), but rejects an incomplete one
+}
+
 static auto zlibInflateInit(z_streamp strm, int zh) -> int {
   if( zh == -1 ) {
     return inflateInit2(strm, -MAX_WBITS);
@@ -69,6 +119,251 @@ static auto zlibInflateInit(z_streamp strm, int zh) -> int {
 
 MTFList mtf(81);
 
+/**
+ * Per-archive caches of encodeZlib().
+ * Containers (PDF, ZIP, sets of PNG images) usually hold many streams made by the same encoder with the same parameters,
+ * and sometimes the very same stream several times.
+ */
+class ZlibCache {
+public:
+    static constexpr int NUM_KEYS = 25 * 4; /**< zlib header (or none) x type of the first deflate block */
+    static constexpr int MAX_STREAMS = 8;
+    static constexpr uint64_t MAX_STREAM_SIZE = 8U << 20U; /**< larger results are not kept */
+
+    struct Stream {
+        uint64_t length; /**< compressed length */
+        uint64_t fingerprint; /**< of the compressed content, to skip most of the streams quickly */
+        uint64_t size; /**< size of the result */
+        int headerSize;
+        int index; /**< the parameters of the result */
+        bool perfect; /**< the parameters reproduced the stream perfectly */
+        FileTmp *original; /**< the compressed stream, a hit must match it byte by byte */
+        FileTmp *data; /**< the result of encodeZlib() */
+    };
+
+private:
+    int params[NUM_KEYS]; /**< the parameters that reproduced the last stream with the same key perfectly, or -1 */
+    Stream streams[MAX_STREAMS] {};
+    int nextStream = 0;
+
+    ZlibCache() {
+      for( int &p: params ) {
+        p = -1;
+      }
+    }
+
+    ~ZlibCache() {
+      for( Stream &s: streams ) {
+        delete s.original;
+        delete s.data;
+      }
+    }
+
+    static auto equal(File *a, File *b, uint64_t size) -> bool {
+      uint8_t bufA[1U << 14U];
+      uint8_t bufB[1U << 14U];
+      while( size > 0 ) {
+        const auto n = static_cast<uint32_t>(min(size, static_cast<uint64_t>(sizeof(bufA))));
+        if( a->blockRead(&bufA[0], n) != n || b->blockRead(&bufB[0], n) != n || memcmp(&bufA[0], &bufB[0], n) != 0 ) {
+          return false;
+        }
+        size -= n;
+      }
+      return true;
+    }
+
+public:
+    static auto getInstance() -> ZlibCache * {
+      static ZlibCache instance;
+      return &instance;
+    }
+
+    /**
+     * @param zh the zlib header (see parseZlibHeader())
+     * @param bType the type of the first deflate block
+     */
+    static auto key(const int zh, const int bType) -> int { return (zh + 1) * 4 + bType; }
+
+    auto getParams(const int key) const -> int { return params[key]; }
+
+    void setParams(const int key, const int index) { params[key] = index; }
+
+    /**
+     * Looks up the stream of @ref length bytes at the current position of @ref in. The position is restored.
+     * @return the cached stream with the very same content, or nullptr
+     */
+    auto findStream(File *in, const uint64_t length, const uint64_t fingerprint) -> const Stream * {
+      const uint64_t start = in->curPos();
+      for( const Stream &s: streams ) {
+        if( s.data != nullptr && s.length == length && s.fingerprint == fingerprint ) {
+          s.original->setpos(0);
+          const bool same = equal(in, s.original, length);
+          in->setpos(start);
+          if( same ) {
+            return &s;
+          }
+        }
+      }
+      return nullptr;
+    }
+
+    /**
+     * Keeps a copy of a result of encodeZlib(): @ref size bytes of @ref out starting at @ref start, and of the stream it was
+     * made of: @ref length bytes of @ref in starting at @ref inStart. The oldest stream is dropped when the cache is full.
+     */
+    void addStream(File *in, const uint64_t inStart, const uint64_t length, const uint64_t fingerprint, const int headerSize,
+                   const int index, const bool perfect, File *out, const uint64_t start, const uint64_t size) {
+      if( size > MAX_STREAM_SIZE || length > MAX_STREAM_SIZE ) {
+        return;
+      }
+      Stream &s = streams[nextStream];
+      nextStream = (nextStream + 1) % MAX_STREAMS;
+      delete s.original;
+      delete s.data;
+      s = {length, fingerprint, size, headerSize, index, perfect, new FileTmp(), new FileTmp()};
+      const uint64_t savedInPos = in->curPos();
+      in->setpos(inStart);
+      copy(in, s.original, length);
+      in->setpos(savedInPos);
+      const uint64_t savedPos = out->curPos();
+      out->setpos(start);
+      copy(out, s.data, size);
+      out->setpos(savedPos);
+    }
+
+    static void copy(File *in, File *out, uint64_t size) {
+      uint8_t buf[1U << 16U];
+      while( size > 0 ) {
+        const auto n = static_cast<uint32_t>(in->blockRead(&buf[0], min(size, static_cast<uint64_t>(sizeof(buf)))));
+        if( n == 0 ) {
+          break;
+        }
+        out->blockWrite(&buf[0], n);
+        size -= n;
+      }
+    }
+};
+
+/**
+ * The header of a transformed zlib stream: the parameters of the recompression and its differences to the original stream.
+ */
+struct ZlibHeader {
+    static constexpr int limit = 128;
+    int diffCount;
+    int window;
+    int index; /**< compression level and memory level */
+    int len; /**< length of the original stream */
+    int diffPos[limit];
+    uint8_t diffByte[limit];
+
+    void read(File *in) {
+      diffCount = min(in->getchar(), limit - 1);
+      window = in->getchar() - MAX_WBITS;
+      index = in->getchar();
+      len = 0;
+      diffPos[0] = -1;
+      for( int i = 0; i <= diffCount; i++ ) {
+        int v = in->get32();
+        if( i == diffCount ) {
+          len = v + diffPos[i];
+        } else {
+          diffPos[i + 1] = v + diffPos[i] + 1;
+        }
+      }
+      diffByte[0] = 0;
+      for( int i = 0; i < diffCount; i++ ) {
+        diffByte[i + 1] = in->getchar();
+      }
+    }
+};
+
+static constexpr int MAX_ZLIB_THREADS = 8;
+
+/**
+ * @return the number of threads for the parameter search of encodeZlib(): set by -zlibthreads, or the number of cores
+ */
+static auto zlibThreads() -> int {
+  const int n = Shared::getInstance()->zlibThreads;
+  return min(n > 0 ? n : max(static_cast<int>(std::thread::hardware_concurrency()), 1), MAX_ZLIB_THREADS);
+}
+
+/**
+ * The threads of the parameter search of encodeZlib(). They are started once, on the first multi-threaded search, and
+ * wait for work between the inflated blocks, so small streams don't pay for creating threads.
+ */
+class ZlibThreadPool {
+private:
+    std::thread threads[MAX_ZLIB_THREADS];
+    int numThreads;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    const std::function<void(int)> *job = nullptr;
+    uint32_t generation = 0; /**< incremented for each job */
+    int running = 0; /**< number of pool threads still working on the current job */
+    bool stopping = false;
+
+    explicit ZlibThreadPool(const int n) : numThreads(n) {
+      for( int t = 1; t < numThreads; t++ ) {
+        threads[t] = std::thread(&ZlibThreadPool::work, this, t);
+      }
+    }
+
+    ~ZlibThreadPool() {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      started.notify_all();
+      for( int t = 1; t < numThreads; t++ ) {
+        threads[t].join();
+      }
+    }
+
+    void work(const int t) {
+      uint32_t done = 0;
+      std::unique_lock<std::mutex> lock(mutex);
+      while( true ) {
+        started.wait(lock, [&] { return stopping || generation != done; });
+        if( stopping ) {
+          return;
+        }
+        done = generation;
+        lock.unlock();
+        (*job)(t);
+        lock.lock();
+        if( --running == 0 ) {
+          finished.notify_one();
+        }
+      }
+    }
+
+public:
+    static auto getInstance() -> ZlibThreadPool & {
+      static ZlibThreadPool instance {zlibThreads()};
+      return instance;
+    }
+
+    auto size() const -> int { return numThreads; }
+
+    /**
+     * Runs @ref f on all threads (the calling thread included) and waits for them to finish.
+     * @param f called with the index of the thread, 0 for the calling thread
+     */
+    void run(const std::function<void(int)> &f) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &f;
+        running = numThreads - 1;
+        generation++;
+      }
+      started.notify_all();
+      f(0);
+      std::unique_lock<std::mutex> lock(mutex);
+      finished.wait(lock, [&] { return running == 0; });
+    }
+};
+
 static auto encodeZlib(File *in, File *out, uint64_t len, int &headerSize) -> int {
   const int block = 1U << 16U;
   const int limit = 128;
@@ -77,11 +372,20 @@ static auto encodeZlib(File *in, File *out, uint64_t len, int &headerSize) -> in
   uint8_t zRec[block * 2];
   uint8_t diffByte[81 * limit];
   uint64_t diffPos[81 * limit];
+  ZlibThreadPool *const pool = zlibThreads() > 1 ? &ZlibThreadPool::getInstance() : nullptr;
+  const int numThreads = pool != nullptr ? pool->size() : 1;
+  Array<uint8_t> zRecs(numThreads > 1 ? (numThreads - 1) * block * 2 : 0); // for the additional threads
+  ZlibCache *cache = ZlibCache::getInstance();
+  const bool selfVerify = Shared::getInstance()->fastVerify;
+  uLong dataCrc = 0; // of the inflated data recompressed by the search (for selfVerify)
+  uint64_t i = 0; // position of the current block
 
   // Step 1 - parse offset type form zlib stream header
   uint64_t posBackup = in->curPos();
+  const uint64_t outStart = out->curPos();
   uint32_t h1 = in->getchar();
   uint32_t h2 = in->getchar();
+  uint32_t h3 = in->getchar();
   in->setpos(posBackup);
   int zh = parseZlibHeader(h1 * 256 + h2);
   int memLevel = 0;
@@ -90,129 +394,219 @@ static auto encodeZlib(File *in, File *out, uint64_t len, int &headerSize) -> in
   int window = zh == -1 ? 0 : MAX_WBITS + 10 + zh / 4;
   int minCLevel = window == 0 ? 1 : cType == 3 ? 7 : cType == 2 ? 6 : cType == 1 ? 2 : 1;
   int maxCLevel = window == 0 ? 9 : cType == 3 ? 9 : cType == 2 ? 6 : cType == 1 ? 5 : 1;
+  const int key = ZlibCache::key(zh, static_cast<int>(((zh == -1 ? h1 : h3) >> 1U) & 3U));
   int index = -1;
   int nTrials = 0;
   bool found = false;
 
+  // A stream seen already in this run is not processed again
+  uint64_t fingerprint = 0;
+  for( i = 0; i < len; i += block ) {
+    const auto blSize = static_cast<uint32_t>(min(len - i, static_cast<uint64_t>(block)));
+    in->blockRead(&zin[0], blSize);
+    for( uint32_t k = 0; k < blSize; k++ ) {
+      fingerprint = (fingerprint + zin[k] + 1) * PHI64;
+      fingerprint ^= fingerprint >> 29U;
+    }
+  }
+  // Several parameters often reproduce a stream perfectly, and the search selects the first one in MTF order. So the cached
+  // parameters (or a cached result with perfect parameters) are used only when the search would test them first: otherwise
+  // the archive would depend on the caches. A result with imperfect parameters does not depend on the MTF order.
+  int first = -1;
+  for( int j = mtf.getFirst(); j >= 0; j = mtf.getNext()) {
+    if( j / 9 + 1 >= minCLevel && j / 9 + 1 <= maxCLevel ) {
+      first = j;
+      break;
+    }
+  }
+  in->setpos(posBackup);
+  const ZlibCache::Stream *stream = cache->findStream(in, len, fingerprint);
+  if( stream != nullptr && (!stream->perfect || stream->index == first)) {
+    stream->data->setpos(0);
+    ZlibCache::copy(stream->data, out, stream->size);
+    headerSize = stream->headerSize;
+    mtf.moveToFront(stream->index);
+    return 1;
+  }
+
   // Step 2 - check recompressibility, determine parameters and save differences
   z_stream mainStrm;
   z_stream recStrm[81];
+  bool active[81];
   int diffCount[81];
   int recPos[81];
   int mainRet = Z_STREAM_END;
-  mainStrm.zalloc = Z_NULL;
-  mainStrm.zfree = Z_NULL;
-  mainStrm.opaque = Z_NULL;
-  mainStrm.next_in = Z_NULL;
-  mainStrm.avail_in = 0;
-  if( zlibInflateInit(&mainStrm, zh) != Z_OK ) {
-    return 0;
-  }
-  for( int i = 0; i < 81; i++ ) {
-    cLevel = (i / 9) + 1;
-    // Early skip if invalid parameter
-    if( cLevel < minCLevel || cLevel > maxCLevel ) {
-      diffCount[i] = limit;
-      continue;
+
+  // Recompresses the current inflated block (zOut) with the parameters of candidate j into rec, and records the differences.
+  // Returns true when the candidate reproduces the whole stream perfectly.
+  auto recompress = [&](const int j, uint8_t *rec) -> bool {
+    recStrm[j].next_in = &zOut[0];
+    recStrm[j].avail_in = block - mainStrm.avail_out;
+    recStrm[j].next_out = &rec[recPos[j]];
+    recStrm[j].avail_out = block * 2 - recPos[j];
+    int ret = deflate(&recStrm[j], mainStrm.total_in == len ? Z_FINISH : Z_NO_FLUSH);
+    if( ret != Z_BUF_ERROR && ret != Z_STREAM_END && ret != Z_OK ) {
+      diffCount[j] = limit;
+      return false;
     }
-    memLevel = (i % 9) + 1;
-    recStrm[i].zalloc = Z_NULL;
-    recStrm[i].zfree = Z_NULL;
-    recStrm[i].opaque = Z_NULL;
-    recStrm[i].next_in = Z_NULL;
-    recStrm[i].avail_in = 0;
-    int ret = deflateInit2(&recStrm[i], cLevel, Z_DEFLATED, window - MAX_WBITS, memLevel, Z_DEFAULT_STRATEGY);
-    diffCount[i] = (ret == Z_OK) ? 0 : limit;
-    recPos[i] = block * 2;
-    diffPos[i * limit] = 0xFFFFFFFFFFFFFFFF;
-    diffByte[i * limit] = 0;
-  }
 
-  for( uint64_t i = 0; i < len; i += block ) {
-    uint32_t blSize = min(uint32_t(len - i), block);
-    nTrials = 0;
-    for( int j = 0; j < 81; j++ ) {
-      if( diffCount[j] == limit ) {
-        continue;
-      }
-      nTrials++;
-      if( recPos[j] >= block ) {
-        recPos[j] -= block;
+    // Compare
+    int end = 2 * block - static_cast<int>(recStrm[j].avail_out);
+    int tail = max(mainRet == Z_STREAM_END ? static_cast<int>(len) - static_cast<int>(recStrm[j].total_out) : 0, 0);
+    for( int k = recPos[j]; k < end + tail; k++ ) {
+      if((k < end && i + k - block < len && rec[k] != zin[k]) || k >= end ) {
+        if( ++diffCount[j] < limit ) {
+          const int p = j * limit + diffCount[j];
+          diffPos[p] = i + k - block;
+          assert(k < int(sizeof(zin) / sizeof(*zin)));
+          diffByte[p] = zin[k];
+        }
       }
     }
-    // early break if nothing left to test
-    if( nTrials == 0 ) {
-      break;
+    if( mainRet == Z_STREAM_END && diffCount[j] == 0 ) {
+      return true;
     }
-    memmove(&zRec[0], &zRec[block], block);
-    memmove(&zin[0], &zin[block], block);
-    in->blockRead(&zin[block], blSize); // Read block from input file
+    recPos[j] = 2U * block - recStrm[j].avail_out;
+    return false;
+  };
 
-    // Decompress/inflate block
-    mainStrm.next_in = &zin[block];
-    mainStrm.avail_in = blSize;
-    do {
-      mainStrm.next_out = &zOut[0];
-      mainStrm.avail_out = block;
-      mainRet = inflate(&mainStrm, Z_FINISH);
-      nTrials = 0;
+  // Tries the given candidate only (and accepts a perfect match only), or all candidates when candidate is -1.
+  // Returns the index of the best parameters, or -1 if there are none.
+  auto search = [&](const int candidate) -> int {
+    index = -1;
+    found = false;
+    mainRet = Z_STREAM_END;
+    dataCrc = crc32(0, Z_NULL, 0);
+    in->setpos(posBackup);
+    mainStrm.zalloc = Z_NULL;
+    mainStrm.zfree = Z_NULL;
+    mainStrm.opaque = Z_NULL;
+    mainStrm.next_in = Z_NULL;
+    mainStrm.avail_in = 0;
+    if( zlibInflateInit(&mainStrm, zh) != Z_OK ) {
+      return -1;
+    }
+    for( int i = 0; i < 81; i++ ) {
+      cLevel = (i / 9) + 1;
+      active[i] = false;
+      // Early skip if invalid parameter
+      if( cLevel < minCLevel || cLevel > maxCLevel || (candidate >= 0 && i != candidate)) {
+        diffCount[i] = limit;
+        continue;
+      }
+      memLevel = (i % 9) + 1;
+      recStrm[i].zalloc = Z_NULL;
+      recStrm[i].zfree = Z_NULL;
+      recStrm[i].opaque = Z_NULL;
+      recStrm[i].next_in = Z_NULL;
+      recStrm[i].avail_in = 0;
+      int ret = deflateInit2(&recStrm[i], cLevel, Z_DEFLATED, window - MAX_WBITS, memLevel, Z_DEFAULT_STRATEGY);
+      active[i] = ret == Z_OK;
+      diffCount[i] = (ret == Z_OK) ? 0 : limit;
+      recPos[i] = block * 2;
+      diffPos[i * limit] = 0xFFFFFFFFFFFFFFFF;
+      diffByte[i * limit] = 0;
+    }
 
-      // Recompress/deflate block with all possible parameters
-      for( int j = mtf.getFirst(); j >= 0; j = mtf.getNext()) {
+    for( i = 0; i < len; i += block ) {
+      uint32_t blSize = min(uint32_t(len - i), block);
+      nTrials = 0;
+      for( int j = 0; j < 81; j++ ) {
         if( diffCount[j] == limit ) {
           continue;
         }
         nTrials++;
-        recStrm[j].next_in = &zOut[0];
-        recStrm[j].avail_in = block - mainStrm.avail_out;
-        recStrm[j].next_out = &zRec[recPos[j]];
-        recStrm[j].avail_out = block * 2 - recPos[j];
-        int ret = deflate(&recStrm[j], mainStrm.total_in == len ? Z_FINISH : Z_NO_FLUSH);
-        if( ret != Z_BUF_ERROR && ret != Z_STREAM_END && ret != Z_OK ) {
-          diffCount[j] = limit;
-          continue;
+        if( recPos[j] >= block ) {
+          recPos[j] -= block;
         }
+      }
+      // early break if nothing left to test
+      if( nTrials == 0 ) {
+        break;
+      }
+      memmove(&zRec[0], &zRec[block], block);
+      memmove(&zin[0], &zin[block], block);
+      in->blockRead(&zin[block], blSize); // Read block from input file
 
-        // Compare
-        int end = 2 * block - static_cast<int>(recStrm[j].avail_out);
-        int tail = max(mainRet == Z_STREAM_END ? static_cast<int>(len) - static_cast<int>(recStrm[j].total_out) : 0, 0);
-        for( int k = recPos[j]; k < end + tail; k++ ) {
-          if((k < end && i + k - block < len && zRec[k] != zin[k]) || k >= end ) {
-            if( ++diffCount[j] < limit ) {
-              const int p = j * limit + diffCount[j];
-              diffPos[p] = i + k - block;
-              assert(k < int(sizeof(zin) / sizeof(*zin)));
-              diffByte[p] = zin[k];
+      // Decompress/inflate block
+      mainStrm.next_in = &zin[block];
+      mainStrm.avail_in = blSize;
+      do {
+        mainStrm.next_out = &zOut[0];
+        mainStrm.avail_out = block;
+        mainRet = inflate(&mainStrm, Z_FINISH);
+        if( selfVerify ) {
+          dataCrc = crc32(dataCrc, &zOut[0], block - mainStrm.avail_out);
+        }
+        nTrials = 0;
+
+        // Recompress/deflate block with all possible parameters
+        if( numThreads <= 1 ) {
+          for( int j = mtf.getFirst(); j >= 0; j = mtf.getNext()) {
+            if( diffCount[j] == limit ) {
+              continue;
+            }
+            nTrials++;
+            if( recompress(j, &zRec[0])) { // Early break on perfect match
+              index = j;
+              found = true;
+              break;
             }
           }
+        } else {
+          // The candidates are distributed among the threads in MTF order. Once a candidate matches perfectly, the candidates
+          // after it are cancelled, and the first perfect one in MTF order is selected - just like in the serial search above.
+          int order[81];
+          for( int j = mtf.getFirst(); j >= 0; j = mtf.getNext()) {
+            if( diffCount[j] != limit ) {
+              order[nTrials++] = j;
+            }
+          }
+          std::atomic<int> next {0};
+          std::atomic<int> firstPerfect {nTrials};
+          pool->run([&](const int t) {
+            uint8_t *rec = t == 0 ? &zRec[0] : &zRecs[(t - 1) * block * 2];
+            for( int k = next++; k < firstPerfect.load(); k = next++ ) {
+              if( recompress(order[k], rec)) {
+                int f = firstPerfect.load();
+                while( k < f && !firstPerfect.compare_exchange_weak(f, k)) {}
+              }
+            }
+          });
+          if( firstPerfect < nTrials ) {
+            index = order[firstPerfect];
+            found = true;
+          }
         }
-        // Early break on perfect match
-        if( mainRet == Z_STREAM_END && diffCount[j] == 0 ) {
-          index = j;
-          found = true;
-          break;
-        }
-        recPos[j] = 2U * block - recStrm[j].avail_out;
+      } while( mainStrm.avail_out == 0 && mainRet == Z_BUF_ERROR && nTrials > 0 );
+      if((mainRet != Z_BUF_ERROR && mainRet != Z_STREAM_END) || nTrials == 0 ) {
+        break;
       }
-    } while( mainStrm.avail_out == 0 && mainRet == Z_BUF_ERROR && nTrials > 0 );
-    if((mainRet != Z_BUF_ERROR && mainRet != Z_STREAM_END) || nTrials == 0 ) {
-      break;
-    }
-  }
-  int minCount = (found) ? 0 : limit;
-  for( int i = 80; i >= 0; i-- ) {
-    cLevel = (i / 9) + 1;
-    if( cLevel >= minCLevel && cLevel <= maxCLevel ) {
-      deflateEnd(&recStrm[i]);
     }
-    if( !found && diffCount[i] < minCount ) {
-      minCount = diffCount[index = i];
+    int minCount = (found || candidate >= 0) ? 0 : limit; // a single candidate must match perfectly
+    for( int i = 80; i >= 0; i-- ) {
+      if( active[i] ) {
+        deflateEnd(&recStrm[i]);
+      }
+      if( !found && diffCount[i] < minCount ) {
+        minCount = diffCount[index = i];
+      }
     }
+    inflateEnd(&mainStrm);
+    return index;
+  };
+
+  // The parameters of the previous stream of the same kind are tried alone first
+  const int cached = cache->getParams(key);
+  if( cached < 0 || cached != first || search(cached) < 0 ) {
+    search(-1);
   }
-  inflateEnd(&mainStrm);
-  if( minCount == limit ) {
+  if( index < 0 ) {
     return 0;
   }
+  if( found ) {
+    cache->setParams(key, index);
+  }
   mtf.moveToFront(index);
 
   // Step 3 - write parameters, differences and precompressed (inflated) data
@@ -254,35 +648,49 @@ static auto encodeZlib(File *in, File *out, uint64_t len, int &headerSize) -> in
   }
   inflateEnd(&mainStrm);
   headerSize = diffCount[index] * 5 + 7;
-  return static_cast<int>(mainRet == Z_STREAM_END);
+  if( mainRet != Z_STREAM_END ) {
+    return 0;
+  }
+
+  // The search above compared the recompressed stream with the original byte by byte. With selfVerify, instead of decoding
+  // it again (see transformEncodeBlock()), the header is read back as decodeZlib() reads it, and the CRC of the stored data
+  // is checked against the data that was recompressed. Deflate output does not depend on how its input is split into calls.
+  if( selfVerify ) {
+    const uint64_t outEnd = out->curPos();
+    out->setpos(outStart);
+    ZlibHeader header;
+    header.read(out);
+    bool ok = header.diffCount == diffCount[index] && header.window + MAX_WBITS == window && header.index == index &&
+              header.len == static_cast<int>(len);
+    for( int i = 1; i <= diffCount[index]; i++ ) {
+      ok = ok && header.diffPos[i] == static_cast<int>(diffPos[index * limit + i]) && header.diffByte[i] == diffByte[index * limit + i];
+    }
+    uLong crc = crc32(0, Z_NULL, 0);
+    for( uint64_t n; (n = out->blockRead(&zOut[0], block)) > 0; ) {
+      crc = crc32(crc, &zOut[0], static_cast<uInt>(n));
+    }
+    out->setpos(outEnd);
+    if( !ok || crc != dataCrc ) {
+      return 0;
+    }
+  }
+  cache->addStream(in, posBackup, len, fingerprint, headerSize, index, found, out, outStart, out->curPos() - outStart);
+  return 1;
 }
 
 static auto decodeZlib(File *in, uint64_t size, File *out, FMode mode, uint64_t &diffFound) -> int {
   const int block = 1U << 16U;
-  const int limit = 128;
   uint8_t zin[block];
   uint8_t zOut[block];
-  int diffCount = min(in->getchar(), limit - 1);
-  int window = in->getchar() - MAX_WBITS;
-  int index = in->getchar();
-  int memLevel = (index % 9) + 1;
-  int cLevel = (index / 9) + 1;
-  int len = 0;
-  int diffPos[limit];
-  diffPos[0] = -1;
-  for( int i = 0; i <= diffCount; i++ ) {
-    int v = in->get32();
-    if( i == diffCount ) {
-      len = v + diffPos[i];
-    } else {
-      diffPos[i + 1] = v + diffPos[i] + 1;
-    }
-  }
-  uint8_t diffByte[limit];
-  diffByte[0] = 0;
-  for( int i = 0; i < diffCount; i++ ) {
-    diffByte[i + 1] = in->getchar();
-  }
+  ZlibHeader header;
+  header.read(in);
+  const int diffCount = header.diffCount;
+  const int window = header.window;
+  const int memLevel = (header.index % 9) + 1;
+  const int cLevel = (header.index / 9) + 1;
+  const int len = header.len;
+  const int *diffPos = header.diffPos;
+  const uint8_t *diffByte = header.diffByte;
   size -= 7 + 5 * diffCount;
 
   z_stream recStrm;
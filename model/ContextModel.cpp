@@ -22,6 +22,7 @@ auto ContextModel::p() -> int {
   uint32_t &blockPosition = stats->blPos;
   // Parse block type and block size
   if( shared->bitPosition == 0 ) {
+    models.releaseIdleModels();
     --blockSize;
     blockPosition++;
     if( blockSize == -1 ) {
@@ -30,7 +31,7 @@ auto ContextModel::p() -> int {
       readSize = true;
     } else if( blockSize < 0 ) {
       if( readSize ) {
-        bytesRead |= int(shared->c1 & 0x7FU) << ((-blockSize - 2) * 7);
+        bytesRead |= static_cast<uint64_t>(shared->c1 & 0x7FU) << ((-blockSize - 2) * 7);
         if((shared->c1 >> 7U) == 0 ) {
           readSize = false;
           if( !hasInfo(nextBlockType)) {
@@ -47,6 +48,9 @@ auto ContextModel::p() -> int {
         blockSize = bytesRead;
         blockInfo = shared->c4;
         blockPosition = 0;
+        if( nextBlockType == MODELMASK ) {
+          modelMask = blockInfo;
+        }
       }
     }
 
@@ -166,6 +170,10 @@ auto ContextModel::p() -> int {
     case TEXT_EOL:
     case RLE:
     case LZW:
+    case DEDUP:
+    case LZ77:
+    case STREAM:
+    case MODELMASK:
       break;
   }
 
@@ -174,31 +182,68 @@ auto ContextModel::p() -> int {
   if( blockType != IMAGE1 ) {
     SparseMatchModel &sparseMatchModel = models.sparseMatchModel();
     sparseMatchModel.mix(*m);
-    SparseModel &sparseModel = models.sparseModel();
-    sparseModel.mix(*m);
+    if((modelMask & MODEL_SPARSE) != 0U ) {
+      SparseModel &sparseModel = models.sparseModel();
+      sparseModel.mix(*m);
+    } else {
+      skip<SparseModel>();
+    }
     RecordModel &recordModel = models.recordModel();
     recordModel.mix(*m);
-    CharGroupModel &charGroupModel = models.charGroupModel();
-    charGroupModel.mix(*m);
+    if((modelMask & MODEL_CHARGROUP) != 0U ) {
+      CharGroupModel &charGroupModel = models.charGroupModel();
+      charGroupModel.mix(*m);
+    } else {
+      skip<CharGroupModel>();
+    }
 #ifndef DISABLE_TEXTMODEL
-    TextModel &textModel = models.textModel();
-    textModel.mix(*m);
-    WordModel &wordModel = models.wordModel();
-    wordModel.mix(*m);
+    if((modelMask & MODEL_TEXT) != 0U ) {
+      TextModel &textModel = models.textModel();
+      textModel.mix(*m);
+      WordModel &wordModel = models.wordModel();
+      wordModel.mix(*m);
+    } else {
+      skip<TextModel>();
+      skip<WordModel>();
+    }
 #endif //DISABLE_TEXTMODEL
-    IndirectModel &indirectModel = models.indirectModel();
-    indirectModel.mix(*m);
-    DmcForest &dmcForest = models.dmcForest();
-    dmcForest.mix(*m);
-    NestModel &nestModel = models.nestModel();
-    nestModel.mix(*m);
-    XMLModel &xmlModel = models.xmlModel();
-    xmlModel.mix(*m);
+    if((modelMask & MODEL_INDIRECT) != 0U ) {
+      IndirectModel &indirectModel = models.indirectModel();
+      indirectModel.mix(*m);
+    } else {
+      skip<IndirectModel>();
+    }
+    if((modelMask & MODEL_DMC) != 0U ) {
+      DmcForest &dmcForest = models.dmcForest();
+      dmcForest.mix(*m);
+    } else {
+      skip<DmcForest>();
+    }
+    if((modelMask & MODEL_NEST) != 0U ) {
+      NestModel &nestModel = models.nestModel();
+      nestModel.mix(*m);
+    } else {
+      skip<NestModel>();
+    }
+    if((modelMask & MODEL_XML) != 0U ) {
+      XMLModel &xmlModel = models.xmlModel();
+      xmlModel.mix(*m);
+    } else {
+      skip<XMLModel>();
+    }
     if( blockType != TEXT && blockType != TEXT_EOL ) {
-      LinearPredictionModel &linearPredictionModel = Models::linearPredictionModel();
-      linearPredictionModel.mix(*m);
-      ExeModel &exeModel = models.exeModel();
-      exeModel.mix(*m);
+      if((modelMask & MODEL_LINEARPREDICTION) != 0U ) {
+        LinearPredictionModel &linearPredictionModel = Models::linearPredictionModel();
+        linearPredictionModel.mix(*m);
+      } else {
+        skip<LinearPredictionModel>();
+      }
+      if((modelMask & MODEL_EXE) != 0U ) {
+        ExeModel &exeModel = models.exeModel();
+        exeModel.mix(*m);
+      } else {
+        skip<ExeModel>();
+      }
     }
   }
 
@@ -13,14 +13,33 @@
 class ContextModel {
     Shared *shared = Shared::getInstance();
     ModelStats *stats;
-    Models models;
+    Models &models;
     Mixer *m;
     BlockType nextBlockType = DEFAULT;
     BlockType blockType = DEFAULT;
-    int blockSize = 0;
+    int64_t blockSize = 0; /**< bytes left in the current block, negative while its header is parsed */
     int blockInfo = 0;
-    int bytesRead = 0;
+    uint64_t bytesRead = 0; /**< the block size being decoded */
     bool readSize = false;
+    uint32_t modelMask = MODEL_ALL; /**< the optional models to run, set by MODELMASK blocks */
+
+    /**
+     * Feed the mixer in place of an optional model that is masked out: the same number of (zero) inputs and mixer
+     * context sets, so that the inputs and weights of the following models stay where they are.
+     * @tparam T the class of the model
+     */
+    template<class T>
+    void skip() {
+      for( int i = 0; i < T::MIXERINPUTS; i++ ) {
+        m->add(0);
+      }
+      if constexpr( T::MIXERCONTEXTSETS > 0 ) {
+        m->set(0, T::MIXERCONTEXTS - (T::MIXERCONTEXTSETS - 1));
+        for( int i = 1; i < T::MIXERCONTEXTSETS; i++ ) {
+          m->set(0, 1);
+        }
+      }
+    }
 
 public:
     ContextModel(ModelStats *st, Models &models);
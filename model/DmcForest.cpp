@@ -13,6 +13,11 @@ DmcForest::~DmcForest() {
 }
 
 void DmcForest::mix(Mixer &m) {
+  // step all state graphs before predicting, so that the node accesses of the models are independent of each other
+  for( int j = MODELS - 1; j >= 0; j-- ) {
+    dmcModels[j]->update();
+  }
+
   int i = MODELS;
   // the slow models predict individually
   m.add(dmcModels[--i]->st() >> 3U);
@@ -105,6 +105,9 @@ auto DmcModel::pr2() -> int {
 }
 
 auto DmcModel::st() -> int {
-  update();
+  // the next update() moves to one of the successors: start fetching both now, so the cache misses of walking the
+  // state graph overlap with the rest of the bit (and with the other models of the forest)
+  PREFETCH(&t[t[curr].getNx0()]);
+  PREFETCH(&t[t[curr].getNx1()]);
   return stretch(pr1()) + stretch(pr2()); // average the predictions for stability
 }
@@ -78,6 +78,11 @@ public:
 
     [[nodiscard]] auto pr1() const -> int;
     auto pr2() -> int;
+
+    /**
+     * Predict the next bit from the current node (call update() first) and prefetch its successors.
+     * @return the sum of the stretched predictions
+     */
     auto st() -> int;
 };
 
@@ -34,6 +34,8 @@ void MatchModel::update() {
   //bytewise contexts
   if( shared->bitPosition == 0 ) {
     // update hashes
+    // combine64() can't remove the oldest byte of a window, so each hash is recomputed from its bytes. It is cheap:
+    // 21 combine64() calls per byte, and a rolling hash would change the hashes (and so the archives).
     for( uint32_t i = 0, minLen = MinLen + (numHashes - 1) * StepSize; i < numHashes; i++, minLen -= StepSize ) {
       uint64_t hash = 0;
       for( uint32_t j = minLen; j > 0; j-- ) {
@@ -21,6 +21,7 @@
 #include "Shared.hpp"
 #include "String.hpp"
 #include "file/FileName.hpp"
+#include "file/FileStream.hpp"
 #include "file/ListOfFiles.hpp"
 #include "file/fileUtils2.hpp"
 #include "filter/Filters.hpp"
@@ -51,6 +52,12 @@ static void printHelp() {
          "          (english.dic, english.exp)\n"
          "      a = Adaptive learning rate\n"
          "      s = Skip the color transform, just reorder the RGB channels\n"
+         "      d = Deduplicate repeated content (within and across input files)\n"
+         "      l = Long-range match transform (replace long repeats at any distance)\n"
+         "      m = Large context maps share one hash table (less memory, usually\n"
+         "          slightly larger archives)\n"
+         "      p = Pick the optional models per block with a quick sampled analysis\n"
+         "          (faster, slightly larger archives)\n"
          "    INPUTSPEC:\n"
          "    The input may be a FILE or a PATH/FILE or a [PATH/]@FILELIST.\n"
          "    Only file content and the file size is kept in the archive. Filename,\n"
@@ -65,6 +72,8 @@ static void printHelp() {
          "    These extra columns will be ignored by the compressor and the decompressor\n"
          "    but you may restore full file information using them with a 3rd party\n"
          "    utility. The FILELIST file must contain a header but will be ignored.\n"
+         "    When INPUTSPEC is - (a single dash) the input is read from the standard\n"
+         "    input in windows of 64 MB. Its size does not need to be known in advance.\n"
          "\n"
          "    OUTPUTSPEC:\n"
          "    When omitted: the archive will be created in the same folder where the\n"
@@ -76,12 +85,15 @@ static void printHelp() {
          "    When OUTPUTSPEC is a folder the archive file will be generated from\n"
          "    the input filename and will be created in the specified folder.\n"
          "    If the archive file already exists it will be overwritten.\n"
+         "    When OUTPUTSPEC is - (a single dash) the archive is written to the\n"
+         "    standard output and all messages go to the standard error.\n"
          "\n"
          "    Examples:\n"
          "      " PROGNAME " -8 enwik8\n"
          "      " PROGNAME " -8ba b64sample.xml\n"
          "      " PROGNAME " -8 @myfolder/myfilelist.txt\n"
          "      " PROGNAME " -8a benchmark/enwik8 results/enwik8_a_" PROGNAME PROGVERSION "\n"
+         "      tar cf - folder | " PROGNAME " -8 - - | ssh host 'cat > folder.tar." PROGNAME PROGVERSION "'\n"
          "\n"
          "To extract (decompress contents):\n"
          "\n"
@@ -90,6 +102,8 @@ static void printHelp() {
          "    folder. If an output filename is not provided output filename will be the\n"
          "    same as ARCHIVEFILE without the last extension (e.g. without ." PROGNAME PROGVERSION")\n"
          "    When OUTPUTPATH does not exist it will be created.\n"
+         "    ARCHIVEFILE and OUTPUTFILE may be - (a single dash) for the standard input\n"
+         "    and output. When reading the standard input OUTPUTFILE is required.\n"
          "    When the archive contains multiple files, first the @LISTFILE is extracted\n"
          "    then the rest of the files. Any required folders will be created.\n"
          "\n"
@@ -118,6 +132,19 @@ static void printHelp() {
          "    -simd [NONE|SSE2|SSSE3|AVX2|NEON]\n"
          "    Overrides detected SIMD instruction set for neural network operations\n"
          "\n"
+         "    -release MB\n"
+         "    Release the memory of the image, audio and jpeg models after MB megabytes\n"
+         "    (1, 2, 4, ... 64) without such content. A model that is needed again\n"
+         "    starts learning from scratch. The setting is stored in the archive.\n"
+         "\n"
+         "    -zlibthreads N\n"
+         "    Search the parameters of zlib streams on N threads (1 to 8, 1: no threads).\n"
+         "    Default: one per core. The archive does not depend on it.\n"
+         "\n"
+         "    -fastverify\n"
+         "    Transforms that already check their output while encoding (zlib) are not\n"
+         "    verified again by decoding. Other transforms are always verified.\n"
+         "\n"
          "Remark: the command line arguments may be used in any order except the input\n"
          "and output: always the input comes first then (the optional) output.\n"
          "\n"
@@ -205,6 +232,17 @@ static void printOptions() {
   printf(" Adaptive   (a) = %s\n", (shared->options & OPTION_ADAPTIVE) != 0U ? "On  (Adaptive learning rate)" : "Off");
   printf(" Skip RGB   (s) = %s\n",
          (shared->options & OPTION_SKIPRGB) != 0U ? "On  (Skip the color transform, just reorder the RGB channels)" : "Off");
+  printf(" Dedup      (d) = %s\n",
+         (shared->options & OPTION_DEDUP) != 0U ? "On  (Deduplicate repeated content)" : "Off"); //this is a compression-only option
+  printf(" Long-range (l) = %s\n",
+         (shared->options & OPTION_LZ77) != 0U ? "On  (Long-range match transform)" : "Off"); //this is a compression-only option
+  printf(" Shared maps(m) = %s\n", shared->contextMapArena ? "On  (Large context maps share one hash table)" : "Off");
+  printf(" Pick models(p) = %s\n", shared->modelSelection ? "On  (Optional models are picked per block)" : "Off"); //this is a compression-only option
+  if( shared->idleModelRelease == 0 ) {
+    printf(" Release idle   = Off\n");
+  } else {
+    printf(" Release idle   = After %d MB (image, audio and jpeg models)\n", 1 << (shared->idleModelRelease - 1));
+  }
   printf(" File mode      = %s\n", (shared->options & OPTION_MULTIPLE_FILE_MODE) != 0U ? "Multiple" : "Single");
 }
 
@@ -242,10 +280,7 @@ auto processCommandLine(int argc, char **argv) -> int {
 
     for( int i = 1; i < argc; i++ ) {
       int argLen = static_cast<int>(strlen(argv[i]));
-      if( argv[i][0] == '-' ) {
-        if( argLen == 1 ) {
-          quit("Empty command.");
-        }
+      if( argv[i][0] == '-' && argLen > 1 ) { // a single dash is a file name: the standard input or output
         if( argv[i][1] >= '0' && argv[i][1] <= '9' ) { // first  digit of level
           if( whattodo != DoNone ) {
             quit("Only one command may be specified.");
@@ -279,6 +314,18 @@ auto processCommandLine(int argc, char **argv) -> int {
               case 'S':
                 shared->options |= OPTION_SKIPRGB;
                 break;
+              case 'D':
+                shared->options |= OPTION_DEDUP;
+                break;
+              case 'L':
+                shared->options |= OPTION_LZ77;
+                break;
+              case 'M':
+                shared->contextMapArena = true;
+                break;
+              case 'P':
+                shared->modelSelection = true;
+                break;
               default: {
                 printf("Invalid compression switch: %c", argv[1][j]);
                 quit();
@@ -302,6 +349,26 @@ auto processCommandLine(int argc, char **argv) -> int {
           whattodo = DoList;
         } else if( strcasecmp(argv[i], "-v") == 0 ) {
           verbose = true;
+        } else if( strcasecmp(argv[i], "-release") == 0 ) {
+          if( ++i == argc ) {
+            quit("The -release switch requires a size in MB.");
+          }
+          const int megabytes = atoi(argv[i]);
+          if( megabytes < 1 || megabytes > 64 || !isPowerOf2(megabytes)) {
+            quit("The -release size must be one of 1, 2, 4, 8, 16, 32 or 64 (MB).");
+          }
+          shared->idleModelRelease = static_cast<uint8_t>(ilog2(megabytes) + 1);
+        } else if( strcasecmp(argv[i], "-zlibthreads") == 0 ) {
+          if( ++i == argc ) {
+            quit("The -zlibthreads switch requires a number of threads.");
+          }
+          const int threads = atoi(argv[i]);
+          if( threads < 1 || threads > 8 ) {
+            quit("The -zlibthreads number must be between 1 and 8.");
+          }
+          shared->zlibThreads = static_cast<uint8_t>(threads);
+        } else if( strcasecmp(argv[i], "-fastverify") == 0 ) {
+          shared->fastVerify = true;
         } else if( strcasecmp(argv[i], "-log") == 0 ) {
           if( logfile.strsize() != 0 ) {
             quit("Only one logfile may be specified.");
@@ -340,7 +407,7 @@ auto processCommandLine(int argc, char **argv) -> int {
           printf("Invalid command: %s", argv[i]);
           quit();
         }
-      } else { //this parameter does not begin with a dash ("-") -> it must be a folder/filename
+      } else { //this parameter does not begin with a dash ("-") or it is a single dash -> it must be a folder/filename
         if( input.strsize() == 0 ) {
           input += argv[i];
           input.replaceSlashes();
@@ -353,6 +420,14 @@ auto processCommandLine(int argc, char **argv) -> int {
       }
     }
 
+    // The standard output must be reserved for the data before anything is flushed to it
+    const bool inputIsStream = FileStream::isStream(input.c_str());
+    const bool outputIsStream = FileStream::isStream(output.c_str());
+    if( outputIsStream ) {
+      FileStream::redirectStdout();
+      shared->toScreen = !Shared::isOutputDirected();
+    }
+
     if( verbose ) {
       printModules();
     }
@@ -410,6 +485,13 @@ auto processCommandLine(int argc, char **argv) -> int {
       quit("The list command needs only one file parameter.");
     }
 
+    if( inputIsStream && output.strsize() == 0 && whattodo != DoList ) {
+      quit("An output must be specified when the input is the standard input.");
+    }
+    if((inputIsStream || outputIsStream) && (shared->options & OPTION_DEDUP) != 0U ) {
+      quit("Deduplication is not available with the standard input or output.");
+    }
+
     // File list supplied?
     if( input.beginsWith("@")) {
       if( whattodo == DoCompress ) {
@@ -438,7 +520,7 @@ auto processCommandLine(int argc, char **argv) -> int {
     }
 
     // Separate paths from input filename/directory name
-    pathType = examinePath(input.c_str());
+    pathType = inputIsStream ? 1 : examinePath(input.c_str());
     if( pathType == 2 || pathType == 4 ) {
       printf("\nSpecified input is a directory but should be a file: %s", input.c_str());
       quit();
@@ -458,7 +540,7 @@ auto processCommandLine(int argc, char **argv) -> int {
     }
 
     // Separate paths from output filename/directory name
-    if( output.strsize() > 0 ) {
+    if( output.strsize() > 0 && !outputIsStream ) {
       pathType = examinePath(output.c_str());
       if( pathType == 1 || pathType == 3 ) { //is an existing file, or looks like a file
         if( output.lastSlashPos() >= 0 ) {
@@ -526,13 +608,15 @@ auto processCommandLine(int argc, char **argv) -> int {
       for( int i = 0; i < listoffiles.getCount(); i++ ) {
         getFileSize(listoffiles.getfilename(i)); // Does file exist? Is it readable? (we don't actually need the file size now)
       }
-    } else { //single file mode or extract/compare/list
+    } else if( !inputIsStream ) { //single file mode or extract/compare/list
       FileName fn(inputPath.c_str());
       fn += input.c_str();
       getFileSize(fn.c_str()); // Does file exist? Is it readable? (we don't actually need the file size now)
     }
 
-    FileDisk archive;  // compressed file
+    FileDisk archiveDisk;
+    FileStream archiveStream;
+    File &archive = (mode == COMPRESS ? outputIsStream : inputIsStream) ? static_cast<File &>(archiveStream) : archiveDisk;  // compressed file
 
     if( mode == DECOMPRESS ) {
       archive.open(archiveName.c_str(), true);
@@ -544,7 +628,10 @@ auto processCommandLine(int argc, char **argv) -> int {
           quit();
         }
       }
-      shared->setLevel(archive.getchar());
+      c = archive.getchar();
+      shared->setLevel(c & LEVEL_MASK);
+      shared->contextMapArena = (c & LEVEL_FLAG_CONTEXTMAP_ARENA) != 0;
+      shared->idleModelRelease = (c >> LEVEL_IDLE_MODEL_RELEASE_SHIFT) & 7U;
       c = archive.getchar();
       if( c == EOF) {
         printf("Unexpected end of archive file.\n");
@@ -571,7 +658,8 @@ auto processCommandLine(int argc, char **argv) -> int {
       }
       archive.create(archiveName.c_str());
       archive.append(PROGNAME);
-      archive.putChar(shared->level);
+      archive.putChar(shared->level | (shared->contextMapArena ? LEVEL_FLAG_CONTEXTMAP_ARENA : 0) |
+                      shared->idleModelRelease << LEVEL_IDLE_MODEL_RELEASE_SHIFT);
       archive.putChar(shared->options);
     }
 
@@ -700,6 +788,17 @@ auto processCommandLine(int argc, char **argv) -> int {
           totalSize += fSize + 4; //4: file size information
           contentSize += fSize;
         }
+      } else if( inputIsStream ) { //single file mode, streaming
+        if( !shared->toScreen ) { //we need a minimal feedback when redirected
+          fprintf(stderr, "\nStandard input\n");
+        }
+        printf("\nStandard input\n");
+        FileStream in;
+        in.open(input.c_str(), true);
+        uint64_t streamSize = compressStream(&in, en);
+        in.close();
+        totalSize += streamSize;
+        contentSize += streamSize;
       } else { //single file mode
         FileName fn;
         fn += inputPath.c_str();
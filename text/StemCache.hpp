@@ -0,0 +1,71 @@
+#ifndef PAQ8PX_STEMCACHE_HPP
+#define PAQ8PX_STEMCACHE_HPP
+
+#include "../Array.hpp"
+#include "../Hash.hpp"
+#include "Stemmer.hpp"
+#include "Word.hpp"
+#include <cstdint>
+#include <cstring>
+
+#ifdef VERBOSE
+#include <cstdio>
+#endif
+
+/**
+ * Direct-mapped memo of the results of a @ref Stemmer.
+ * Text repeats the same few thousand words, so most words don't need to be run through the suffix tables again.
+ * Entries are selected by the word hashes and verified by comparing the whole input word, so a hit produces exactly
+ * the word, the type flags, the language and the result that stemming would.
+ * @tparam hashBits log2 of the number of entries
+ */
+template<int hashBits>
+class StemCache {
+private:
+    struct Entry {
+        Word in; /**< word before stemming (all zeroes when the entry is unused: such a word is never stemmed) */
+        Word out; /**< word after stemming */
+        bool result;
+    };
+
+    Array<Entry> entries {1U << hashBits};
+#ifdef VERBOSE
+    uint32_t requests {};
+    uint32_t hits {};
+#endif
+
+public:
+#ifdef VERBOSE
+    ~StemCache() {
+      if( requests > 0 ) {
+        printf("\nStem cache hits: %d, Requests: %d, %.2f%%\n", hits, requests, (hits * 100.0) / requests);
+      }
+    }
+#endif
+
+    /**
+     * Stems @ref w with @ref stemmer, or reuses the result of an earlier call with an identical word.
+     * @param stemmer the stemmer this cache belongs to
+     * @param w the word to stem
+     * @return the return value of Stemmer::stem()
+     */
+    auto stem(Stemmer *stemmer, Word *w) -> bool {
+      Entry &e = entries[finalize64(hash(w->Hash[0], w->Hash[1]), hashBits)];
+#ifdef VERBOSE
+      requests++;
+#endif
+      if( memcmp(&e.in, w, sizeof(Word)) == 0 ) {
+#ifdef VERBOSE
+        hits++;
+#endif
+        memcpy(w, &e.out, sizeof(Word));
+        return e.result;
+      }
+      memcpy(&e.in, w, sizeof(Word));
+      e.result = stemmer->stem(w);
+      memcpy(&e.out, w, sizeof(Word));
+      return e.result;
+    }
+};
+
+#endif //PAQ8PX_STEMCACHE_HPP
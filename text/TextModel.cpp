@@ -112,7 +112,7 @@ void TextModel::update() {
         if( i != Lang.id ) {
           memcpy(&words[i](0), cWord, sizeof(Word));
         }
-        if( stemmers[i - 1]->stem(&words[i](0))) {
+        if( stemCaches[i - 1].stem(stemmers[i - 1], &words[i](0))) {
           Lang.count[i - 1]++, Lang.mask[i - 1] |= 1U;
         }
       }
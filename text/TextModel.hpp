@@ -16,6 +16,7 @@
 #include "Paragraph.hpp"
 #include "Segment.hpp"
 #include "Sentence.hpp"
+#include "StemCache.hpp"
 #include "Stemmer.hpp"
 #include "Word.hpp"
 #include "WordEmbeddingDictionary.hpp"
@@ -38,6 +39,7 @@ private:
     static constexpr uint32_t MIN_RECOGNIZED_WORDS = 4;
     ContextMap2 cm;
     Array<Stemmer *> stemmers;
+    StemCache<11> stemCaches[Language::Count - 1];
     Array<Language *> languages;
     Array<WordEmbeddingDictionary *> dictionaries;
     Cache<Word, 8> words[Language::Count];
@@ -28,7 +28,7 @@ void WordEmbeddingDictionary::addEntry(const short prefix, const uint8_t suffix,
   index += static_cast<int>(index < 0x8000);
 }
 
-WordEmbeddingDictionary::WordEmbeddingDictionary() : entries(0x8000), table(hashSize), index(0) { reset(); }
+WordEmbeddingDictionary::WordEmbeddingDictionary() : entries(0x8000), table(hashSize), index(0), memo(1U << memoBits) { reset(); }
 
 WordEmbeddingDictionary::~WordEmbeddingDictionary() {
 #ifdef VERBOSE
@@ -38,7 +38,15 @@ WordEmbeddingDictionary::~WordEmbeddingDictionary() {
 #endif
 }
 
+void WordEmbeddingDictionary::clearMemo() {
+  if( memoInUse ) {
+    memset(&memo[0], 0, sizeof(Memo) << memoBits);
+    memoInUse = false;
+  }
+}
+
 void WordEmbeddingDictionary::reset() {
+  clearMemo();
   for( index = 0; index < hashSize; table[index] = -1, index++ ) { ;
   }
   for( index = 0; index < 256; index++ ) {
@@ -59,6 +67,7 @@ auto WordEmbeddingDictionary::addWord(const Word *w, const uint32_t embedding) -
   if( len == 0 ) {
     return res;
   }
+  clearMemo();
   for( int i = 0; i < len; i++ ) {
     int idx = findEntry(parent, code = (*w)[i]);
     if( idx < 0 ) {
@@ -83,8 +92,20 @@ void WordEmbeddingDictionary::getWordEmbedding(Word *w) {
 #ifdef VERBOSE
   requests++;
 #endif
-  w->embedding = -1;
-  for( uint32_t i = 0; i < w->length(); i++ ) {
+  const uint32_t length = w->length();
+  Memo &m = memo[finalize64(hash(w->Hash[1], length), memoBits)];
+  if( m.length == length && memcmp(m.letters, &w->letters[w->start], length) == 0 ) {
+    w->embedding = m.embedding;
+#ifdef VERBOSE
+    hits += static_cast<uint32_t>(w->embedding != static_cast<uint32_t>(-1));
+#endif
+    return;
+  }
+  memoInUse = true;
+  m.length = length;
+  memcpy(m.letters, &w->letters[w->start], length);
+  m.embedding = w->embedding = -1;
+  for( uint32_t i = 0; i < length; i++ ) {
     if((parent = findEntry(parent, (*w)[i])) < 0 ) {
       return;
     }
@@ -92,14 +113,14 @@ void WordEmbeddingDictionary::getWordEmbedding(Word *w) {
   if( !entries[parent].termination ) {
     return;
   }
-  w->embedding = entries[parent].embedding;
+  m.embedding = w->embedding = entries[parent].embedding;
 #ifdef VERBOSE
   hits++;
 #endif
 }
 
 void WordEmbeddingDictionary::loadFromFile(const char *filename) {
-  FileDisk f;
+  FileMapped f;
 #ifdef VERBOSE
   if (shared->toScreen) { 
     printf("\b\b\b\b\b\b\b\b\b\b\b\b\b\b\b");
@@ -2,6 +2,7 @@
 #define PAQ8PX_WORDEMBEDDINGDICTIONARY_HPP
 
 #include "../file/FileDisk.hpp"
+#include "../file/FileMapped.hpp"
 #include "../file/OpenFromMyFolder.hpp"
 #include "Entry.hpp"
 #include "Word.hpp"
@@ -13,9 +14,22 @@
 class WordEmbeddingDictionary {
 private:
     static constexpr int hashSize = 81929;
+    static constexpr int memoBits = 10;
     Array<Entry> entries;
     Array<short> table;
     int index;
+
+    /**
+     * Direct-mapped memo of the last lookups, so that a frequent word doesn't walk the dictionary one letter at a time.
+     */
+    struct Memo {
+        uint8_t letters[Word::maxWordSize];
+        uint32_t length; /**< 0: unused */
+        uint32_t embedding;
+    };
+    Array<Memo> memo;
+    bool memoInUse = false; /**< the memo has to be cleared before the dictionary changes */
+    void clearMemo();
 #ifdef VERBOSE
     uint32_t requests{};
     uint32_t hits{};
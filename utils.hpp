@@ -157,21 +157,25 @@ typedef enum {
     TEXT,
     TEXT_EOL,
     RLE,
-    LZW
+    LZW,
+    DEDUP,
+    LZ77,
+    STREAM,
+    MODELMASK /**< an empty block: its info is the set of optional models to run from here on (compression switch "p") */
 } BlockType;
 
 static inline auto hasRecursion(BlockType ft) -> bool {
-  return ft == CD || ft == ZLIB || ft == BASE64 || ft == GIF || ft == RLE || ft == LZW || ft == FILECONTAINER;
+  return ft == CD || ft == ZLIB || ft == BASE64 || ft == GIF || ft == RLE || ft == LZW || ft == LZ77 || ft == FILECONTAINER || ft == STREAM;
 }
 
 static inline auto hasInfo(BlockType ft) -> bool {
   return ft == IMAGE1 || ft == IMAGE4 || ft == IMAGE8 || ft == IMAGE8GRAY || ft == IMAGE24 || ft == IMAGE32 || ft == AUDIO ||
-         ft == AUDIO_LE || ft == PNG8 || ft == PNG8GRAY || ft == PNG24 || ft == PNG32;
+         ft == AUDIO_LE || ft == PNG8 || ft == PNG8GRAY || ft == PNG24 || ft == PNG32 || ft == MODELMASK;
 }
 
 static inline auto hasTransform(BlockType ft) -> bool {
   return ft == IMAGE24 || ft == IMAGE32 || ft == AUDIO_LE || ft == EXE || ft == CD || ft == ZLIB || ft == BASE64 || ft == GIF ||
-         ft == TEXT_EOL || ft == RLE || ft == LZW;
+         ft == TEXT_EOL || ft == RLE || ft == LZW || ft == LZ77;
 }
 
 static inline auto isPNG(BlockType ft) -> bool { return ft == PNG8 || ft == PNG8GRAY || ft == PNG24 || ft == PNG32; }
@@ -182,6 +186,25 @@ static inline auto isPNG(BlockType ft) -> bool { return ft == PNG8 || ft == PNG8
 #define OPTION_TRAINTXT 8U
 #define OPTION_ADAPTIVE 16U
 #define OPTION_SKIPRGB 32U
+#define OPTION_DEDUP 64U
+#define OPTION_LZ77 128U
+
+// optional models, the bits of the info of a MODELMASK block
+#define MODEL_SPARSE 1U
+#define MODEL_CHARGROUP 2U
+#define MODEL_TEXT 4U /**< TextModel and WordModel */
+#define MODEL_INDIRECT 8U
+#define MODEL_DMC 16U
+#define MODEL_NEST 32U
+#define MODEL_XML 64U
+#define MODEL_LINEARPREDICTION 128U
+#define MODEL_EXE 256U
+#define MODEL_ALL 511U
+
+// the options byte of the archive header is full: the following are stored in the (otherwise unused) top bits of the level byte
+#define LEVEL_MASK 15U
+#define LEVEL_FLAG_CONTEXTMAP_ARENA 128U
+#define LEVEL_IDLE_MODEL_RELEASE_SHIFT 4U /**< bits 4-6: Shared::idleModelRelease */
 
 //////////////////// Cross-platform definitions /////////////////////////////////////
 
@@ -201,6 +224,8 @@ static inline auto isPNG(BlockType ft) -> bool { return ft == PNG8 || ft == PNG8
 
 #ifdef WINDOWS
 #define strcasecmp _stricmp
+#define getc_unlocked(a) _getc_nolock(a)
+#define putc_unlocked(a, b) _putc_nolock(a, b)
 #endif
 
 #if defined(__GNUC__) || defined(__clang__)
@@ -223,6 +248,15 @@ static inline auto isPNG(BlockType ft) -> bool { return ft == PNG8 || ft == PNG8
 +   ((x) << 56))
 #endif
 
+#if defined(__GNUC__) || defined(__clang__)
+#define PREFETCH(x) __builtin_prefetch(x)
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <xmmintrin.h>
+#define PREFETCH(x) _mm_prefetch(reinterpret_cast<const char *>(x), _MM_HINT_T0)
+#else
+#define PREFETCH(x) ((void) (x))
+#endif
+
 
 #define TAB 0x09
 #define NEW_LINE 0x0A